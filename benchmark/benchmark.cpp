@@ -0,0 +1,155 @@
+/*
+ * Matrix benchmarks
+ * 
+ * Build (from repository root):
+ *   cmake -S . -B build && cmake --build build --target matrix_benchmark
+ * 
+ * Thread count follows MATRIX_NUM_THREADS (defaults to all hardware threads).
+ */
+#include "matrix.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#pragma region HELPERS
+
+/**
+ * @brief Matrix of given size filled with uniform values in [-1, 1)
+ * 
+ */
+Matrix random_matrix(size_t rows, size_t columns, unsigned seed=1) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> dist(-1, 1);
+    Matrix M(rows, columns);
+    for(size_t i=0; i<rows; ++i)
+        for(size_t j=0; j<columns; ++j)
+            M(i, j) = dist(rng);
+    return M;
+}
+
+/**
+ * @brief best wall time (seconds) of func over enough repetitions to run for
+ *        roughly minSeconds
+ * 
+ */
+template <typename F>
+double time_best(F func, double minSeconds=0.2) {
+    using clock = chrono::steady_clock;
+    double best = 1e300, total = 0;
+    int reps = 0;
+    while(total < minSeconds || reps < 3) {
+        auto start = clock::now();
+        func();
+        double elapsed = chrono::duration<double>(clock::now() - start).count();
+        best = min(best, elapsed);
+        total += elapsed;
+        ++reps;
+    }
+    return best;
+}
+
+#pragma endregion // HELPERS
+/******************************************************************************/
+#pragma region BENCHMARKS
+
+/**
+ * @brief reference i-j-k product on vector<vector<double>> (the original
+ *        Matrix::operator* algorithm)
+ * 
+ */
+vector<vector<double>> naive_multiply(const vector<vector<double>>& A,
+                                      const vector<vector<double>>& B) {
+    vector<vector<double>> C;
+    for(size_t i=0; i<A.size(); ++i) {
+        vector<double> row;
+        for(size_t j=0; j<B[0].size(); ++j) {
+            double sum = 0;
+            for(size_t k=0; k<B.size(); ++k)
+                sum += A[i][k] * B[k][j];
+            row.push_back(sum);
+        }
+        C.push_back(row);
+    }
+    return C;
+}
+
+/**
+ * @brief Matrix::operator*(const Matrix&) against the naive product
+ * 
+ */
+void bench_multiply() {
+    printf("%-12s %8s %12s %12s %10s %10s\n", "multiply", "n",
+           "naive (ms)", "Matrix (ms)", "GFLOP/s", "speedup");
+    for(size_t n : {16, 32, 64, 96, 128, 256, 512, 1024}) {
+        Matrix A = random_matrix(n, n, 1), B = random_matrix(n, n, 2);
+        vector<vector<double>> a(n, vector<double>(n)), b = a;
+        for(size_t i=0; i<n; ++i)
+            for(size_t j=0; j<n; ++j) {
+                a[i][j] = A(i, j);
+                b[i][j] = B(i, j);
+            }
+        double naive = time_best([&] { naive_multiply(a, b); });
+        double fast = time_best([&] { Matrix C = A * B; });
+        printf("%-12s %8zu %12.3f %12.3f %10.2f %9.1fx\n", "", n,
+               naive * 1e3, fast * 1e3, 2.0 * n * n * n / fast * 1e-9,
+               naive / fast);
+    }
+}
+
+/**
+ * @brief SymmetricEigen against the general eigensolver on symmetric input
+ * 
+ */
+void bench_symmetric_eigen() {
+    printf("%-12s %8s %12s %12s %12s %12s\n", "sym eigen", "n",
+           "general (ms)", "values (ms)", "vectors (ms)", "10 pairs (ms)");
+    for(size_t n : {16, 64, 128, 256, 512}) {
+        Matrix A = random_matrix(n, n, 3);
+        for(size_t i=0; i<n; ++i)
+            for(size_t j=0; j<i; ++j)
+                A(j, i) = A(i, j);
+        double general = time_best([&] { A.eigenvalues(); });
+        double values = time_best([&] { SymmetricEigen(A, false); });
+        double vectors = time_best([&] { SymmetricEigen(A, true); });
+        double subset = time_best([&] {
+            SymmetricEigen::by_index(A, n - 10, n - 1);
+        });
+        printf("%-12s %8zu %12.3f %12.3f %12.3f %12.3f\n", "", n,
+               general * 1e3, values * 1e3, vectors * 1e3, subset * 1e3);
+    }
+}
+
+/**
+ * @brief MatrixF against Matrix on the same products and elementwise sums
+ * 
+ */
+void bench_precision() {
+    printf("%-12s %8s %12s %12s %12s %12s\n", "precision", "n",
+           "mul f64 (ms)", "mul f32 (ms)", "add f64 (ms)", "add f32 (ms)");
+    for(size_t n : {64, 128, 256, 512, 1024, 2048}) {
+        Matrix A = random_matrix(n, n, 1), B = random_matrix(n, n, 2), C;
+        MatrixF Af(A), Bf(B), Cf;
+        double mul64 = time_best([&] { C = A * B; });
+        double mul32 = time_best([&] { Cf = Af * Bf; });
+        double add64 = time_best([&] { C = A + B * 2.0; });
+        double add32 = time_best([&] { Cf = Af + Bf * 2.0; });
+        printf("%-12s %8zu %12.3f %12.3f %12.3f %12.3f\n", "", n,
+               mul64 * 1e3, mul32 * 1e3, add64 * 1e3, add32 * 1e3);
+    }
+}
+
+#pragma endregion // BENCHMARKS
+
+int main() {
+    printf("threads: %zu\n\n", ThreadPool::instance().size());
+    bench_multiply();
+    printf("\n");
+    bench_symmetric_eigen();
+    printf("\n");
+    bench_precision();
+    return 0;
+}
@@ -0,0 +1,522 @@
+/*
+ * Matrix benchmark suite: every public operation over a sweep of sizes and
+ * shapes, with machine readable output and regression checks
+ *
+ * Build (from repository root):
+ *   cmake -S . -B build && cmake --build build --target matrix_suite
+ *
+ * Usage:
+ *   matrix_suite [--max-size N] [--filter TEXT] [--min-time SECONDS]
+ *                [--json FILE] [--baseline FILE] [--threshold FRACTION]
+ *
+ *   --max-size   largest dimension swept (powers of two from 2, default 1024,
+ *                4096 for the full sweep); slow operations stop earlier
+ *   --filter     only run operations whose name contains TEXT
+ *   --min-time   seconds each measurement repeats for (default 0.1)
+ *   --json       write results to FILE, one record per line
+ *   --baseline   compare against a FILE written by --json, flagging results
+ *                slower than the baseline by more than --threshold (default
+ *                0.10); the exit status is 1 when any are flagged
+ *
+ * Times are the best of the repetitions. GFLOP/s uses the usual operation
+ * count of each algorithm ("-" where there is none), and allocations count
+ * every operator new made by one call, thread pool tasks included.
+ * Thread count follows MATRIX_NUM_THREADS (defaults to all hardware threads).
+ */
+#include "matrix.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#pragma region ALLOCATION_COUNTING
+
+static atomic<size_t> g_allocs(0); // operator new calls
+static atomic<size_t> g_bytes(0); // bytes requested from operator new
+
+void* _counted_new(size_t size) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_bytes.fetch_add(size, memory_order_relaxed);
+    if(void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+void* _counted_new(size_t size, align_val_t align) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_bytes.fetch_add(size, memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if(void* ptr = aligned_alloc(alignment, size ? size : alignment))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size) { return _counted_new(size); }
+void* operator new[](size_t size) { return _counted_new(size); }
+void* operator new(size_t size, align_val_t align) {
+    return _counted_new(size, align);
+}
+void* operator new[](size_t size, align_val_t align) {
+    return _counted_new(size, align);
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+
+#pragma endregion // ALLOCATION_COUNTING
+/******************************************************************************/
+#pragma region HELPERS
+
+/**
+ * @brief Matrix of given size filled with uniform values in [-1, 1)
+ *
+ */
+Matrix random_matrix(size_t rows, size_t columns, unsigned seed=1) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> dist(-1, 1);
+    Matrix M(rows, columns);
+    for(size_t i=0; i<rows; ++i)
+        for(size_t j=0; j<columns; ++j)
+            M(i, j) = dist(rng);
+    return M;
+}
+
+/**
+ * @brief random n x n Matrix made diagonally dominant, so it is well
+ *        conditioned for determinant, inverse and solve
+ *
+ */
+Matrix random_square(size_t n, unsigned seed=1) {
+    Matrix M = random_matrix(n, n, seed);
+    for(size_t i=0; i<n; ++i)
+        M(i, i) += n;
+    return M;
+}
+
+/**
+ * @brief best wall time (seconds) of func, repeated until minSeconds have
+ *        passed and at least three runs were made (a single run when it
+ *        alone takes minSeconds)
+ *
+ */
+double time_best(const function<void()>& func, double minSeconds) {
+    using clock = chrono::steady_clock;
+    double best = 1e300, total = 0;
+    int reps = 0;
+    while(total < minSeconds || reps < 3) {
+        auto start = clock::now();
+        func();
+        double elapsed = chrono::duration<double>(clock::now() - start).count();
+        best = min(best, elapsed);
+        total += elapsed;
+        if(++reps == 1 && elapsed >= minSeconds)
+            break;
+    }
+    return best;
+}
+
+#pragma endregion // HELPERS
+/******************************************************************************/
+#pragma region OPERATIONS
+
+enum Shape { SQUARE = 1, TALL = 2, WIDE = 4, ALL_SHAPES = 7 };
+
+const char* shape_name(Shape shape) {
+    return shape == SQUARE ? "square" : shape == TALL ? "tall" : "wide";
+}
+
+/**
+ * @brief one benchmarked operation: setup() builds the inputs for a rows x
+ *        columns case and returns the call to time
+ *
+ */
+struct Operation {
+    const char* name;
+    int shapes; // Shape flags this operation runs on
+    size_t maxSize; // largest dimension swept (slow operations stop early)
+    function<double(double m, double n)> flops; // 0 when not meaningful
+    function<function<void()>(size_t rows, size_t columns)> setup;
+};
+
+/**
+ * @brief the operations swept by the suite, in output order
+ *
+ */
+vector<Operation> operations() {
+    auto none = [](double, double) { return 0.0; };
+    auto elementwise = [](double m, double n) { return m * n; };
+    auto lu_flops = [](double m, double) { return 2.0 / 3.0 * m * m * m; };
+    vector<Operation> ops;
+
+    /* Construction and copies */
+
+    ops.push_back({"construct_zero", ALL_SHAPES, 4096, none,
+        [](size_t m, size_t n) -> function<void()> {
+            return [=] { Matrix A(m, n); };
+        }});
+    ops.push_back({"construct_identity", SQUARE, 4096, none,
+        [](size_t m, size_t) -> function<void()> {
+            return [=] { Matrix A(m); };
+        }});
+    ops.push_back({"construct_nested_vector", ALL_SHAPES, 2048, none,
+        [](size_t m, size_t n) -> function<void()> {
+            auto rows = make_shared<vector<vector<double>>>(
+                m, vector<double>(n, 1.5));
+            return [rows] { Matrix A(*rows); };
+        }});
+    ops.push_back({"copy_then_write", ALL_SHAPES, 4096, none,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { Matrix B = *A; B(0, 0) = 1; };
+        }});
+
+    /* Arithmetic */
+
+    ops.push_back({"add", ALL_SHAPES, 4096, elementwise,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n, 1));
+            auto B = make_shared<Matrix>(random_matrix(m, n, 2));
+            auto C = make_shared<Matrix>();
+            return [A, B, C] { *C = *A + *B; };
+        }});
+    ops.push_back({"add_scaled", ALL_SHAPES, 4096,
+        [](double m, double n) { return 2 * m * n; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n, 1));
+            auto B = make_shared<Matrix>(random_matrix(m, n, 2));
+            auto C = make_shared<Matrix>();
+            return [A, B, C] { *C = *A + *B * 2.0; };
+        }});
+    ops.push_back({"scale_in_place", ALL_SHAPES, 4096, elementwise,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { *A *= 1.0000001; };
+        }});
+    ops.push_back({"multiply", ALL_SHAPES, 4096,
+        [](double m, double n) { return 2 * m * n * m; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n, 1));
+            auto B = make_shared<Matrix>(random_matrix(n, m, 2));
+            return [A, B] { Matrix C = *A * *B; };
+        }});
+    ops.push_back({"multiply_add", ALL_SHAPES, 4096,
+        [](double m, double n) { return 2 * m * n * m + 2 * m * m; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n, 1));
+            auto B = make_shared<Matrix>(random_matrix(n, m, 2));
+            auto C = make_shared<Matrix>(random_matrix(m, m, 3));
+            return [A, B, C] { C->multiply_add(*A, *B, 1, 0.5); };
+        }});
+    ops.push_back({"multiply_vector", ALL_SHAPES, 4096,
+        [](double m, double n) { return 2 * m * n; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            auto x = make_shared<vector<double>>(n, 0.5);
+            auto y = make_shared<vector<double>>(m);
+            return [A, x, y] { A->multiply_vector(*x, *y); };
+        }});
+    ops.push_back({"vector_multiply", ALL_SHAPES, 4096,
+        [](double m, double n) { return 2 * m * n; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            auto x = make_shared<vector<double>>(m, 0.5);
+            return [A, x] { Matrix y = *x * *A; };
+        }});
+    ops.push_back({"vec_dot", SQUARE, 4096,
+        [](double m, double n) { return 2 * m * n; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto a = make_shared<Matrix>(random_matrix(m * n, 1, 1));
+            auto b = make_shared<Matrix>(random_matrix(m * n, 1, 2));
+            return [a, b] { volatile double dot = a->vec_dot(*b); (void)dot; };
+        }});
+
+    /* Transposes */
+
+    ops.push_back({"transpose", ALL_SHAPES, 4096, none,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { Matrix B = A->transpose(); };
+        }});
+    ops.push_back({"transpose_in_place", SQUARE, 4096, none,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { A->transpose_in_place(); };
+        }});
+
+    /* Elimination and factorizations */
+
+    ops.push_back({"determinant", SQUARE, 4096, lu_flops,
+        [](size_t m, size_t) -> function<void()> {
+            auto A = make_shared<Matrix>(random_square(m));
+            return [A] { volatile double det = A->determinant(); (void)det; };
+        }});
+    ops.push_back({"inverse", SQUARE, 2048,
+        [](double m, double) { return 2 * m * m * m; },
+        [](size_t m, size_t) -> function<void()> {
+            auto A = make_shared<Matrix>(random_square(m));
+            return [A] { Matrix B = A->inverse(); };
+        }});
+    ops.push_back({"rref", ALL_SHAPES, 1024,
+        [](double m, double n) { return m * m * n; },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { Matrix B = A->rref(); };
+        }});
+    ops.push_back({"lu", SQUARE, 4096, lu_flops,
+        [](size_t m, size_t) -> function<void()> {
+            auto A = make_shared<Matrix>(random_square(m));
+            return [A] { LU f = A->lu(); };
+        }});
+    ops.push_back({"cholesky", SQUARE, 4096,
+        [](double m, double) { return m * m * m / 3; },
+        [](size_t m, size_t) -> function<void()> {
+            Matrix R = random_matrix(m, m);
+            auto A = make_shared<Matrix>(R.transpose() * R);
+            for(size_t i=0; i<m; ++i)
+                (*A)(i, i) += m;
+            return [A] { Cholesky f = A->cholesky(); };
+        }});
+    ops.push_back({"solve", SQUARE, 4096,
+        [](double m, double) { return 2.0 / 3.0 * m * m * m + 2 * m * m; },
+        [](size_t m, size_t) -> function<void()> {
+            auto A = make_shared<Matrix>(random_square(m));
+            auto b = make_shared<vector<double>>(m, 1.0);
+            return [A, b] { vector<double> x = A->solve(*b); };
+        }});
+    ops.push_back({"qr", SQUARE | TALL, 2048,
+        [](double m, double n) {
+            double k = min(m, n), l = max(m, n);
+            return 2 * l * k * k - 2.0 / 3.0 * k * k * k;
+        },
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { Matrix::MatrixPair QR = A->qr(); };
+        }});
+
+    /* Eigenvalues */
+
+    ops.push_back({"eigenvalues", SQUARE, 512,
+        [](double m, double) { return 10 * m * m * m; },
+        [](size_t m, size_t) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, m));
+            return [A] { auto values = A->eigenvalues(); };
+        }});
+    ops.push_back({"eigenvalues_approx", SQUARE, 256, none,
+        [](size_t m, size_t) -> function<void()> {
+            Matrix R = random_matrix(m, m);
+            auto A = make_shared<Matrix>(R + R.transpose());
+            return [A] { auto values = A->eigenvalues_approx(1e-10, 1000); };
+        }});
+    ops.push_back({"symmetric_eigen", SQUARE, 1024,
+        [](double m, double) { return 4.0 / 3.0 * m * m * m; },
+        [](size_t m, size_t) -> function<void()> {
+            Matrix R = random_matrix(m, m);
+            auto A = make_shared<Matrix>(R + R.transpose());
+            return [A] { SymmetricEigen e(*A, false); };
+        }});
+
+    /* Output */
+
+    ops.push_back({"print", ALL_SHAPES, 256, none,
+        [](size_t m, size_t n) -> function<void()> {
+            auto A = make_shared<Matrix>(random_matrix(m, n));
+            return [A] { ostringstream os; os << *A; };
+        }});
+    return ops;
+}
+
+#pragma endregion // OPERATIONS
+/******************************************************************************/
+#pragma region RESULTS
+
+struct Result {
+    string op;
+    string shape;
+    size_t rows;
+    size_t columns;
+    double seconds;
+    double gflops; // 0 without a flop count
+    double allocs; // operator new calls per call
+    double bytes; // bytes allocated per call
+};
+
+/**
+ * @return key identifying a case across runs
+ */
+string result_key(const string& op, const string& shape, size_t rows,
+                  size_t columns) {
+    return op + "/" + shape + "/" + to_string(rows) + "x" + to_string(columns);
+}
+
+/**
+ * @brief writes results as JSON, one record per line
+ *
+ */
+void write_json(const string& path, const vector<Result>& results) {
+    ofstream out(path);
+    if(!out)
+        throw runtime_error("cannot write " + path);
+    out << "{\"threads\": " << ThreadPool::instance().size()
+        << ", \"results\": [\n";
+    char line[512];
+    for(size_t i=0; i<results.size(); ++i) {
+        const Result& r = results[i];
+        snprintf(line, sizeof(line), "{\"op\": \"%s\", \"shape\": \"%s\", "
+                 "\"rows\": %zu, \"columns\": %zu, \"seconds\": %.9g, "
+                 "\"gflops\": %.6g, \"allocs\": %.6g, \"bytes\": %.6g}%s\n",
+                 r.op.c_str(), r.shape.c_str(), r.rows, r.columns, r.seconds,
+                 r.gflops, r.allocs, r.bytes,
+                 i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "]}\n";
+}
+
+/**
+ * @return value of "key": in a record line written by write_json()
+ */
+string json_field(const string& line, const string& key) {
+    size_t pos = line.find("\"" + key + "\": ");
+    if(pos == string::npos)
+        return "";
+    pos += key.size() + 4;
+    if(line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        return line.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end - pos);
+}
+
+/**
+ * @brief baseline seconds by result_key(), read from a write_json() file
+ *
+ */
+map<string, double> read_baseline(const string& path) {
+    ifstream in(path);
+    if(!in)
+        throw runtime_error("cannot read " + path);
+    map<string, double> baseline;
+    string line;
+    while(getline(in, line)) {
+        string op = json_field(line, "op");
+        if(op.empty())
+            continue;
+        baseline[result_key(op, json_field(line, "shape"),
+                            stoul(json_field(line, "rows")),
+                            stoul(json_field(line, "columns")))]
+            = stod(json_field(line, "seconds"));
+    }
+    return baseline;
+}
+
+#pragma endregion // RESULTS
+
+int main(int argc, char** argv) {
+    size_t maxSize = 1024;
+    double minTime = 0.1, threshold = 0.10;
+    string filter, jsonPath, baselinePath;
+    for(int i=1; i<argc; ++i) {
+        string arg = argv[i];
+        if(i + 1 >= argc) {
+            fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return 2;
+        }
+        string value = argv[++i];
+        if(arg == "--max-size")
+            maxSize = stoul(value);
+        else if(arg == "--filter")
+            filter = value;
+        else if(arg == "--min-time")
+            minTime = stod(value);
+        else if(arg == "--json")
+            jsonPath = value;
+        else if(arg == "--baseline")
+            baselinePath = value;
+        else if(arg == "--threshold")
+            threshold = stod(value);
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 2;
+        }
+    }
+    map<string, double> baseline;
+    if(!baselinePath.empty())
+        baseline = read_baseline(baselinePath);
+
+    printf("threads: %zu\n\n", ThreadPool::instance().size());
+    printf("%-24s %-7s %11s %12s %10s %10s %12s %s\n", "operation", "shape",
+           "size", "time (us)", "GFLOP/s", "allocs", "bytes", "baseline");
+    vector<Result> results;
+    int regressions = 0;
+    for(const Operation& op : operations()) {
+        if(!filter.empty() && string(op.name).find(filter) == string::npos)
+            continue;
+        for(Shape shape : {SQUARE, TALL, WIDE}) {
+            if(!(op.shapes & shape))
+                continue;
+            for(size_t n=2; n<=min(maxSize, op.maxSize); n*=2) {
+                // tall and wide cases keep a 4:1 aspect ratio
+                size_t rows = shape == WIDE ? max<size_t>(1, n / 4) : n;
+                size_t columns = shape == TALL ? max<size_t>(1, n / 4) : n;
+                function<void()> call = op.setup(rows, columns);
+                call(); // warm up caches, the thread pool and lazy tables
+                size_t allocs = g_allocs.load(), bytes = g_bytes.load();
+                call();
+                Result r{op.name, shape_name(shape), rows, columns, 0, 0,
+                         double(g_allocs.load() - allocs),
+                         double(g_bytes.load() - bytes)};
+                r.seconds = time_best(call, minTime);
+                double flops = op.flops(double(rows), double(columns));
+                r.gflops = flops > 0 ? flops / r.seconds * 1e-9 : 0;
+
+                char gflops[16] = "-", versus[24] = "";
+                if(r.gflops > 0)
+                    snprintf(gflops, sizeof(gflops), "%.2f", r.gflops);
+                auto found = baseline.find(
+                    result_key(r.op, r.shape, rows, columns));
+                if(found != baseline.end()) {
+                    double change = r.seconds / found->second - 1;
+                    bool slower = change > threshold;
+                    regressions += slower;
+                    snprintf(versus, sizeof(versus), "%+.1f%%%s",
+                             change * 100, slower ? " REGRESSION" : "");
+                }
+                char size[24];
+                snprintf(size, sizeof(size), "%zux%zu", rows, columns);
+                printf("%-24s %-7s %11s %12.2f %10s %10.0f %12.0f %s\n",
+                       op.name, r.shape.c_str(), size, r.seconds * 1e6, gflops,
+                       r.allocs, r.bytes, versus);
+                fflush(stdout);
+                results.push_back(r);
+            }
+        }
+    }
+    if(!jsonPath.empty())
+        write_json(jsonPath, results);
+    if(!baseline.empty()) {
+        printf("\n%d regression%s over %.0f%%\n", regressions,
+               regressions == 1 ? "" : "s", threshold * 100);
+        return regressions ? 1 : 0;
+    }
+    return 0;
+}
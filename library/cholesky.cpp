@@ -0,0 +1,249 @@
+#include "cholesky.h"
+#include "kernels.h"
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+#define CHOLESKY_BLOCK 64 // columns factored before the trailing update
+
+#pragma region CONSTRUCTORS
+
+/**
+ * @brief Factor a symmetric positive definite Matrix
+ * 
+ * @param A Matrix to factor (copied, lower triangle read)
+ */
+Cholesky::Cholesky(const Matrix& A) : _l(A) {
+    _factor();
+}
+/**
+ * @brief Factor a symmetric positive definite Matrix in place of its storage
+ * 
+ * @param A Matrix to factor (moved from, lower triangle read)
+ */
+Cholesky::Cholesky(Matrix&& A) : _l(move(A)) {
+    _factor();
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region GET_FUNCTIONS
+
+/**
+ * @return true if the Matrix was positive definite (factor is usable)
+ */
+bool Cholesky::spd() const {
+    return _spd;
+}
+
+/**
+ * @return L on and below the diagonal (upper triangle is unspecified)
+ */
+const Matrix& Cholesky::factors() const {
+    return _l;
+}
+
+/**
+ * @return lower triangular factor L
+ */
+Matrix Cholesky::L() const {
+    size_t n = _l.num_rows();
+    Matrix lower(n, n);
+    double* l = lower._mutable_data();
+    const size_t ld = lower.leading_dim();
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<=i; ++j)
+            l[i*ld + j] = _l(i, j);
+    return lower;
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region MATH_FUNCTIONS
+
+/**
+ * @brief returns determinate of factored Matrix
+ * 
+ */
+double Cholesky::determinant() const {
+    _check_solve(_l.num_rows());
+    double det = 1;
+    for(size_t i=0; i<(size_t)_l.num_rows(); ++i)
+        det *= _l(i, i) * _l(i, i);
+    return det;
+}
+
+/**
+ * @brief returns log of the determinant (does not overflow for large
+ *        matrices)
+ * 
+ */
+double Cholesky::log_determinant() const {
+    _check_solve(_l.num_rows());
+    double sum = 0;
+    for(size_t i=0; i<(size_t)_l.num_rows(); ++i)
+        sum += log(_l(i, i));
+    return 2 * sum;
+}
+
+/**
+ * @brief returns inverse of factored Matrix
+ * 
+ */
+Matrix Cholesky::inverse() const {
+    Matrix I((size_t)_l.num_rows());
+    solve_in_place(I._mutable_view());
+    return I;
+}
+
+/**
+ * @brief Solves A * X = B for X
+ * 
+ * @param B right hand sides, one per column (rows must match A)
+ */
+Matrix Cholesky::solve(const Matrix& B) const {
+    Matrix X(B);
+    solve_in_place(X._mutable_view());
+    return X;
+}
+/**
+ * @brief Solves A * x = b for x
+ * 
+ * @param b right hand side (size must match rows of A)
+ */
+vector<double> Cholesky::solve(const vector<double>& b) const {
+    vector<double> x(b);
+    solve_in_place(x);
+    return x;
+}
+
+/**
+ * @brief Solves A * X = B, overwriting B with X (no allocation unless B is a
+ *        view with strided columns)
+ * 
+ * @param B right hand sides, one per column (rows must match A)
+ */
+void Cholesky::solve_in_place(MatrixView B) const {
+    _check_solve(B.rows());
+    if(B.column_stride() != 1) { // substitution needs contiguous rows
+        Matrix X(B);
+        _substitute(X._mutable_data(), X.num_columns(), X.leading_dim());
+        B = X;
+        return;
+    }
+    _substitute(B.data(), B.columns(), B.row_stride());
+}
+/**
+ * @brief Solves A * x = b, overwriting b with x (no allocation)
+ * 
+ * @param b right hand side (size must match rows of A)
+ */
+void Cholesky::solve_in_place(vector<double>& b) const {
+    _check_solve(b.size());
+    _substitute(b.data(), 1, 1);
+}
+
+#pragma endregion // MATH_FUNCTIONS
+/******************************************************************************/
+#pragma region FACTORIZATION
+
+/**
+ * @brief blocked right-looking Cholesky: factor a CHOLESKY_BLOCK wide
+ *        diagonal block, solve for the panel below it, then update the lower
+ *        triangle of the trailing submatrix one block column at a time with
+ *        _gemm (which spreads the work over the thread pool)
+ * 
+ */
+void Cholesky::_factor() {
+    if(_l.empty())
+        throw invalid_argument("Matrix must have data");
+    if(_l.num_rows() != _l.num_columns())
+        throw invalid_argument("Matrix must be square");
+    const size_t n = _l.num_rows(), ld = _l.leading_dim();
+    MATRIX_OP("cholesky", n, n, double(n) * n * n / 3);
+    double* a = _l._mutable_data();
+    for(size_t k0=0; k0<n; k0+=CHOLESKY_BLOCK) {
+        const size_t nb = min<size_t>(CHOLESKY_BLOCK, n - k0), k1 = k0 + nb;
+        MATRIX_TRACE_SPAN("cholesky block", n - k0, nb, (long)k0);
+        if(!_factor_block(k0, nb)) {
+            _spd = false;
+            return;
+        }
+        if(k1 == n)
+            break;
+        // L21 = A21 * L11^-T, each row a forward substitution with L11
+        ThreadPool::instance().parallel_for(k1, n,
+            max<size_t>(1, PARALLEL_MIN_WORK / (nb * nb)),
+            [&](size_t lo, size_t hi) {
+                for(size_t i=lo; i<hi; ++i) {
+                    double* row = a + i*ld + k0;
+                    for(size_t j=0; j<nb; ++j) {
+                        const double* lj = a + (k0 + j)*ld + k0;
+                        double sum = row[j];
+                        for(size_t p=0; p<j; ++p)
+                            sum -= row[p] * lj[p];
+                        row[j] = sum / lj[j];
+                    }
+                }
+            });
+        // A22 -= L21 * L21^T, lower triangle only
+        for(size_t j0=k1; j0<n; j0+=CHOLESKY_BLOCK) {
+            const size_t width = min<size_t>(CHOLESKY_BLOCK, n - j0);
+            _gemm(n - j0, width, nb, -1.0, a + j0*ld + k0, ld, 1,
+                  a + j0*ld + k0, 1, ld, 1.0, a + j0*ld + j0, ld);
+        }
+    }
+}
+
+/**
+ * @brief unblocked Cholesky of the nb x nb diagonal block at k0
+ * 
+ * @return false if a pivot is not positive (Matrix not positive definite)
+ */
+bool Cholesky::_factor_block(size_t k0, size_t nb) {
+    const size_t ld = _l.leading_dim();
+    double* a = _l._mutable_data() + k0*ld + k0;
+    for(size_t j=0; j<nb; ++j) {
+        double* lj = a + j*ld;
+        double pivot = lj[j];
+        for(size_t p=0; p<j; ++p)
+            pivot -= lj[p] * lj[p];
+        if(!(pivot > 0)) // also catches NaN
+            return false;
+        lj[j] = sqrt(pivot);
+        for(size_t i=j+1; i<nb; ++i) {
+            double* li = a + i*ld;
+            double sum = li[j];
+            for(size_t p=0; p<j; ++p)
+                sum -= li[p] * lj[p];
+            li[j] = sum / lj[j];
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief throws if the factor cannot be used with a right hand side with
+ *        given rows
+ * 
+ */
+void Cholesky::_check_solve(size_t rows) const {
+    if(!_spd)
+        throw domain_error("Matrix is not positive definite");
+    if(rows != (size_t)_l.num_rows())
+        throw invalid_argument("Right hand side must have same rows as Matrix");
+}
+
+/**
+ * @brief forward substitution with L, then back substitution with L^T
+ * 
+ */
+void Cholesky::_substitute(double* B, size_t k, size_t ldb) const {
+    const size_t n = _l.num_rows(), ld = _l.leading_dim();
+    MATRIX_OP("cholesky_solve", n, k, 2.0 * n * n * k);
+    _trsm(true, false, n, k, _l.data(), ld, 1, B, ldb);
+    _trsm(false, false, n, k, _l.data(), 1, ld, B, ldb);
+}
+
+#pragma endregion // FACTORIZATION
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef MATRIX_CHOLESKY_H
+#define MATRIX_CHOLESKY_H
+
+#include "matrix.h"
+#include <vector>
+
+/**
+ * @brief Cholesky factorization of a symmetric positive definite Matrix,
+ *        A = L * L^T
+ * 
+ * Takes about half the work of LU and needs no pivoting. Only the lower
+ * triangle of A is read. Factoring stops at the first pivot that is not
+ * positive, so input that is not positive definite is rejected after at
+ * most the work done up to that column; check spd() before using the factor.
+ */
+class Cholesky {
+public:
+
+    /* Constructors */
+
+    Cholesky(const Matrix& A);
+    Cholesky(Matrix&& A);
+
+    /* Get functions */
+
+    bool spd() const;
+    const Matrix& factors() const;
+    Matrix L() const;
+
+    /* Math functions */
+
+    double determinant() const;
+    double log_determinant() const;
+    Matrix inverse() const;
+    Matrix solve(const Matrix& B) const;
+    std::vector<double> solve(const std::vector<double>& b) const;
+    void solve_in_place(MatrixView B) const;
+    void solve_in_place(std::vector<double>& b) const;
+
+private:
+    Matrix _l; // L on and below the diagonal, upper triangle unspecified
+    bool _spd = true; // false if a pivot was not positive
+
+    void _factor();
+    bool _factor_block(std::size_t k0, std::size_t nb);
+    void _check_solve(std::size_t rows) const;
+    void _substitute(double* B, std::size_t k, std::size_t ldb) const;
+};
+
+#endif
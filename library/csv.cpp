@@ -0,0 +1,297 @@
+#include "matrix.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <algorithm>
+#include <charconv> // from_chars(), to_chars()
+#include <cstring> // memchr(), memmove()
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define CSV_CHUNK (1 << 23) // bytes of text read or formatted at a time
+#define CSV_MAX_LINE (1 << 30) // longest line read_csv() accepts
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief one line of text, without its line break
+ *
+ */
+struct _TextLine {
+    const char* begin;
+    const char* end;
+};
+
+/**
+ * @return true for blanks skipped around fields (a tab is a separator, not
+ *         a blank, in tab separated text)
+ */
+inline bool _is_blank(char c, char delimiter) {
+    return c == ' ' || (c == '\t' && delimiter != '\t');
+}
+inline const char* _skip_blanks(const char* p, const char* end,
+                                char delimiter) {
+    while(p < end && _is_blank(*p, delimiter))
+        ++p;
+    return p;
+}
+
+/**
+ * @return number of fields on a line
+ */
+size_t _count_fields(const char* p, const char* end, char delimiter) {
+    if(delimiter != ' ')
+        return 1 + count(p, end, delimiter);
+    size_t fields = 0;
+    while((p = _skip_blanks(p, end, delimiter)) < end) {
+        ++fields;
+        while(p < end && !_is_blank(*p, delimiter))
+            ++p;
+    }
+    return fields;
+}
+
+/**
+ * @brief parses exactly columns numbers from a line into dst; fields may be
+ *        padded with blanks, quoted and start with '+'
+ *
+ * @return false if the line is not columns numbers
+ */
+template <typename Scalar>
+bool _parse_line(const char* p, const char* end, char delimiter,
+                 Scalar* dst, size_t columns) {
+    for(size_t j=0; j<columns; ++j) {
+        p = _skip_blanks(p, end, delimiter);
+        const bool quoted = p < end && *p == '"';
+        p += quoted;
+        if(p + 1 < end && *p == '+' && p[1] != '-')
+            ++p;
+        from_chars_result parsed = from_chars(p, end, dst[j]);
+        if(parsed.ec != errc())
+            return false;
+        p = parsed.ptr;
+        if(quoted && (p == end || *p++ != '"'))
+            return false;
+        p = _skip_blanks(p, end, delimiter);
+        if(delimiter != ' ' && j+1 < columns
+           && (p == end || *p++ != delimiter))
+            return false;
+    }
+    return p == end;
+}
+
+/**
+ * @brief splits text into lines, leaving out blank ones
+ *
+ */
+void _split_lines(const char* p, const char* end, char delimiter,
+                  vector<_TextLine>& lines) {
+    lines.clear();
+    while(p < end) {
+        const char* next = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* stop = next ? next : end;
+        const char* last = stop;
+        if(last > p && last[-1] == '\r')
+            --last;
+        if(_skip_blanks(p, last, delimiter) < last)
+            lines.push_back({p, last});
+        p = next ? next + 1 : end;
+    }
+}
+
+/**
+ * @brief appends value to out, in the shortest form that reads back exactly
+ *
+ */
+template <typename Scalar>
+void _append_number(string& out, Scalar value) {
+    char buffer[64];
+    to_chars_result written = to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, written.ptr);
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region TEXT_FILES
+
+/**
+ * @brief Read a Matrix from delimiter separated text, one row per line
+ *
+ * Text is read CSV_CHUNK bytes at a time and each chunk is parsed by the
+ * thread pool straight into Matrix storage, so memory beyond the Matrix
+ * stays bounded. A delimiter of ' ' separates fields by any run of spaces
+ * and tabs. Blank lines are skipped and the first line is skipped when
+ * header is true.
+ *
+ * @throws runtime_error if a row is not all numbers or has a different
+ *         number of columns than the first
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::read_csv(istream& in, char delimiter,
+                                                  bool header) {
+    /* total bytes, if the stream can tell, to size storage up front */
+    uint64_t total = 0;
+    const streampos start = in.tellg();
+    if(start != streampos(-1) && in.seekg(0, ios::end)) {
+        total = in.tellg() - start;
+        in.seekg(start);
+    }
+    in.clear();
+
+    BasicMatrix result;
+    vector<char> buffer(CSV_CHUNK);
+    vector<_TextLine> lines;
+    size_t carry = 0; // bytes of an unfinished line kept from the last chunk
+    size_t columns = 0, rows = 0;
+    bool skipHeader = header, eof = false;
+    while(!eof) {
+        in.read(buffer.data() + carry, buffer.size() - carry);
+        const size_t length = carry + in.gcount();
+        eof = !in;
+        if(in.bad())
+            throw runtime_error("Cannot read text");
+        /* parse up to the last complete line */
+        size_t used = length;
+        if(!eof) {
+            while(used && buffer[used-1] != '\n')
+                --used;
+            if(!used) { // line longer than the buffer
+                if(buffer.size() >= CSV_MAX_LINE)
+                    throw runtime_error("Line is too long");
+                carry = length;
+                buffer.resize(buffer.size() * 2);
+                continue;
+            }
+        }
+        _split_lines(buffer.data(), buffer.data() + used, delimiter, lines);
+        size_t first = 0;
+        if(skipHeader && !lines.empty()) {
+            skipHeader = false;
+            first = 1;
+        }
+        if(!columns && first < lines.size()) {
+            columns = _count_fields(lines[first].begin, lines[first].end,
+                                    delimiter);
+            size_t expected = lines.size() - first;
+            if(!eof && total > used)
+                expected = min<size_t>(MAX_MATRIX_SIZE,
+                    expected * ((double)total / used) * 1.05);
+            result._reserve(expected, columns);
+            result._columns = columns;
+        }
+        const size_t count = lines.size() - first;
+        if(count) {
+            if(rows + count > MAX_MATRIX_SIZE)
+                throw out_of_range("size must be less than MAX_MATRIX_SIZE");
+            if(rows + count > result._capacity)
+                result._reserve(rows + count, columns);
+            Scalar* data = result._data + rows * result._ld;
+            const size_t ld = result._ld;
+            _for_rows(count, columns, [&](size_t lo, size_t hi) {
+                for(size_t i=lo; i<hi; ++i) {
+                    const _TextLine& line = lines[first + i];
+                    if(!_parse_line(line.begin, line.end, delimiter,
+                                    data + i*ld, columns))
+                        throw runtime_error("Row " + to_string(rows + i + 1)
+                            + ": expected " + to_string(columns) + " numbers");
+                }
+            });
+            rows += count;
+            result._rows = rows;
+        }
+        carry = length - used;
+        memmove(buffer.data(), buffer.data() + used, carry);
+    }
+    return result;
+}
+/**
+ * @brief Read a Matrix from a delimiter separated text file (see above)
+ *
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::read_csv(const string& path,
+                                                  char delimiter,
+                                                  bool header) {
+    ifstream file(path, ios::binary);
+    if(!file)
+        throw runtime_error("Cannot open " + path);
+    return read_csv(file, delimiter, header);
+}
+
+/**
+ * @brief Write Matrix as delimiter separated text, one row per line
+ *
+ * Numbers are written in the shortest form that reads back to the same
+ * value. Rows are formatted by the thread pool about CSV_CHUNK bytes at a
+ * time and written in order.
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::write_csv(ostream& out, char delimiter) const {
+    if(!_data)
+        return;
+    const size_t blockRows = max<size_t>(1, CSV_CHUNK / (24 * _columns));
+    const size_t partRows = max<size_t>(1, PARALLEL_MIN_WORK / _columns);
+    vector<string> parts;
+    for(size_t r0=0; r0<_rows; r0+=blockRows) {
+        const size_t r1 = min(_rows, r0 + blockRows);
+        parts.resize((r1 - r0 + partRows - 1) / partRows);
+        auto format = [&](size_t lo, size_t hi) {
+            for(size_t p=lo; p<hi; ++p) {
+                string& part = parts[p];
+                part.clear();
+                const size_t end = min(r1, r0 + (p+1) * partRows);
+                for(size_t i=r0 + p*partRows; i<end; ++i) {
+                    const Scalar* row = _data + i*_ld;
+                    for(size_t j=0; j<_columns; ++j) {
+                        if(j)
+                            part += delimiter;
+                        _append_number(part, row[j]);
+                    }
+                    part += '\n';
+                }
+            }
+        };
+        if(parts.size() > 1)
+            ThreadPool::instance().parallel_for(0, parts.size(), 1, format);
+        else
+            format(0, parts.size());
+        for(const string& part : parts)
+            out.write(part.data(), part.size());
+    }
+    if(!out)
+        throw runtime_error("Cannot write text");
+}
+/**
+ * @brief Write Matrix to a delimiter separated text file (see above)
+ *
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::write_csv(const string& path, char delimiter) const {
+    ofstream file(path, ios::binary | ios::trunc);
+    if(!file)
+        throw runtime_error("Cannot open " + path);
+    write_csv(file, delimiter);
+    file.close();
+    if(!file)
+        throw runtime_error("Cannot write " + path);
+}
+
+#pragma endregion // TEXT_FILES
+/******************************************************************************/
+#pragma region EXPLICIT_INSTANTIATIONS
+
+#define INSTANTIATE_TEXT_MEMBERS(S) \
+template BasicMatrix<S> BasicMatrix<S>::read_csv(istream& in, char delimiter, \
+                                                 bool header); \
+template BasicMatrix<S> BasicMatrix<S>::read_csv(const string& path, \
+                                                 char delimiter, bool header); \
+template void BasicMatrix<S>::write_csv(ostream& out, char delimiter) const; \
+template void BasicMatrix<S>::write_csv(const string& path, \
+                                        char delimiter) const;
+
+INSTANTIATE_TEXT_MEMBERS(double)
+INSTANTIATE_TEXT_MEMBERS(float)
+
+#pragma endregion // EXPLICIT_INSTANTIATIONS
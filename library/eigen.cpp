@@ -0,0 +1,231 @@
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+#pragma region HESSENBERG
+
+/**
+ * @brief Householder reduction to Hessenberg form: for every column, one
+ *        reflector zeros the elements below the subdiagonal and is applied
+ *        from both sides
+ * 
+ */
+void _hessenberg(size_t n, double* A, size_t lda) {
+    vector<double> v(n), f(n);
+    for(size_t m=1; m+1<n; ++m) {
+        MATRIX_TRACE_SPAN("hessenberg column", n - m, n - m + 1, (long)m);
+        double scale = 0; // scaling keeps the norm from over/underflowing
+        for(size_t i=m; i<n; ++i)
+            scale += fabs(A[i*lda + m-1]);
+        if(scale == 0)
+            continue;
+        double h = 0;
+        for(size_t i=m; i<n; ++i) {
+            v[i] = A[i*lda + m-1] / scale;
+            h += v[i] * v[i];
+        }
+        double g = v[m] > 0 ? -sqrt(h) : sqrt(h);
+        h -= v[m] * g;
+        v[m] -= g;
+        // A = (I - v*v^T/h) * A, rows m.. (f = v^T * A / h)
+        fill(f.begin() + m-1, f.end(), 0.0);
+        for(size_t i=m; i<n; ++i) {
+            const double* row = A + i*lda;
+            for(size_t j=m-1; j<n; ++j)
+                f[j] += v[i] * row[j];
+        }
+        for(size_t i=m; i<n; ++i) {
+            const double vi = v[i] / h;
+            double* row = A + i*lda;
+            for(size_t j=m-1; j<n; ++j)
+                row[j] -= vi * f[j];
+        }
+        // A = A * (I - v*v^T/h), columns m..
+        for(size_t i=0; i<n; ++i) {
+            double* row = A + i*lda;
+            double dot = 0;
+            for(size_t j=m; j<n; ++j)
+                dot += v[j] * row[j];
+            dot /= h;
+            for(size_t j=m; j<n; ++j)
+                row[j] -= dot * v[j];
+        }
+        A[m*lda + m-1] = scale * g;
+        for(size_t i=m+1; i<n; ++i)
+            A[i*lda + m-1] = 0;
+    }
+}
+
+#pragma endregion // HESSENBERG
+/******************************************************************************/
+#pragma region FRANCIS_QR
+
+/**
+ * @brief Francis double shift QR on the active window [l, hi] of H; each
+ *        sweep chases a 3x3 bulge down the subdiagonal in O(n^2), and one or
+ *        two eigenvalues are split off whenever a subdiagonal element becomes
+ *        negligible. Exceptional shifts after 10 and 30 stalled sweeps break
+ *        cycles.
+ * 
+ */
+bool _hessenberg_eigenvalues(size_t n, double* H, size_t ldh,
+                             double tolerance, size_t max_sweeps,
+                             vector<complex<double>>& values) {
+    values.assign(n, 0.0);
+    auto h = [&](size_t i, size_t j) -> double& { return H[i*ldh + j]; };
+    tolerance = max(tolerance, numeric_limits<double>::epsilon());
+    double norm = 0;
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=(i ? i-1 : 0); j<n; ++j)
+            norm += fabs(h(i, j));
+
+    double exshift = 0, p = 0, q = 0, r = 0, s = 0, z = 0, w, x, y;
+    size_t iter = 0, sweeps = 0;
+    long hi = (long)n - 1;
+    while(hi >= 0) {
+        long l = hi; // look for a negligible subdiagonal element
+        while(l > 0) {
+            s = fabs(h(l-1, l-1)) + fabs(h(l, l));
+            if(s == 0)
+                s = norm;
+            if(fabs(h(l, l-1)) <= tolerance * s) // <= so a zero Matrix deflates
+                break;
+            --l;
+        }
+        if(l == hi) { // one real root
+            values[hi] = h(hi, hi) + exshift;
+            --hi;
+            iter = 0;
+        } else if(l == hi - 1) { // two roots from trailing 2x2 block
+            w = h(hi, hi-1) * h(hi-1, hi);
+            p = (h(hi-1, hi-1) - h(hi, hi)) / 2;
+            q = p*p + w;
+            z = sqrt(fabs(q));
+            x = h(hi, hi) + exshift;
+            if(q >= 0) {
+                z = p >= 0 ? p + z : p - z;
+                values[hi-1] = x + z;
+                values[hi] = z != 0 ? x - w / z : x + z;
+            } else {
+                values[hi-1] = complex<double>(x + p, z);
+                values[hi] = complex<double>(x + p, -z);
+            }
+            hi -= 2;
+            iter = 0;
+        } else {
+            MATRIX_COUNT("eigenvalues.sweeps", 1);
+            if(++sweeps > max_sweeps)
+                return false;
+            MATRIX_TRACE_SPAN("francis sweep", hi - l + 1, hi - l + 1,
+                              (long)sweeps);
+            x = h(hi, hi);
+            y = h(hi-1, hi-1);
+            w = h(hi, hi-1) * h(hi-1, hi);
+            if(iter == 10) { // exceptional shift
+                exshift += x;
+                for(long i=0; i<=hi; ++i)
+                    h(i, i) -= x;
+                s = fabs(h(hi, hi-1)) + fabs(h(hi-1, hi-2));
+                x = y = 0.75 * s;
+                w = -0.4375 * s * s;
+            }
+            if(iter == 30) { // second exceptional shift
+                s = (y - x) / 2;
+                s = s*s + w;
+                if(s > 0) {
+                    s = sqrt(s);
+                    if(y < x)
+                        s = -s;
+                    s = x - w / ((y - x) / 2 + s);
+                    for(long i=0; i<=hi; ++i)
+                        h(i, i) -= s;
+                    exshift += s;
+                    x = y = w = 0.964;
+                }
+            }
+            ++iter;
+
+            long m = hi - 2; // look for two consecutive small subdiagonals
+            while(m >= l) {
+                z = h(m, m);
+                r = x - z;
+                s = y - z;
+                p = (r*s - w) / h(m+1, m) + h(m, m+1);
+                q = h(m+1, m+1) - z - r - s;
+                r = h(m+2, m+1);
+                s = fabs(p) + fabs(q) + fabs(r);
+                p /= s;
+                q /= s;
+                r /= s;
+                if(m == l)
+                    break;
+                if(fabs(h(m, m-1)) * (fabs(q) + fabs(r)) < tolerance
+                   * (fabs(p) * (fabs(h(m-1, m-1)) + fabs(z)
+                                 + fabs(h(m+1, m+1)))))
+                    break;
+                --m;
+            }
+            for(long i=m+2; i<=hi; ++i) {
+                h(i, i-2) = 0;
+                if(i > m+2)
+                    h(i, i-3) = 0;
+            }
+
+            // each bulge step updates 3 rows and 3 columns of the window
+            MATRIX_ADD_FLOPS(10.0 * (hi - m) * (hi - l + 4));
+            for(long k=m; k<=hi-1; ++k) { // chase the bulge
+                bool notlast = k != hi - 1;
+                if(k != m) {
+                    p = h(k, k-1);
+                    q = h(k+1, k-1);
+                    r = notlast ? h(k+2, k-1) : 0;
+                    x = fabs(p) + fabs(q) + fabs(r);
+                    if(x == 0)
+                        continue;
+                    p /= x;
+                    q /= x;
+                    r /= x;
+                }
+                s = sqrt(p*p + q*q + r*r);
+                if(p < 0)
+                    s = -s;
+                if(s == 0)
+                    continue;
+                if(k != m)
+                    h(k, k-1) = -s * x;
+                else if(l != m)
+                    h(k, k-1) = -h(k, k-1);
+                p += s;
+                x = p / s;
+                y = q / s;
+                z = r / s;
+                q /= p;
+                r /= p;
+                for(long j=k; j<=hi; ++j) { // rows k..k+2 of window
+                    p = h(k, j) + q * h(k+1, j);
+                    if(notlast) {
+                        p += r * h(k+2, j);
+                        h(k+2, j) -= p * z;
+                    }
+                    h(k, j) -= p * x;
+                    h(k+1, j) -= p * y;
+                }
+                for(long i=l; i<=min(hi, k+3); ++i) { // columns k..k+2
+                    p = x * h(i, k) + y * h(i, k+1);
+                    if(notlast) {
+                        p += z * h(i, k+2);
+                        h(i, k+2) -= p * r;
+                    }
+                    h(i, k) -= p;
+                    h(i, k+1) -= p * q;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#pragma endregion // FRANCIS_QR
@@ -0,0 +1,414 @@
+#pragma once
+#ifndef MATRIX_FIXED_MATRIX_H
+#define MATRIX_FIXED_MATRIX_H
+
+#include "matrix.h"
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+
+/*
+ * Matrix with dimentions fixed at compile time
+ * 
+ * Elements live inside the object (no heap allocation, no augment lines, no
+ * print settings) and every loop has a compile time trip count, so small
+ * products, determinants and inverses are fully unrolled. Everything is
+ * constexpr, so FixedMatrix values can be computed at compile time.
+ * Converts to and from Matrix for code that mixes both.
+ */
+
+/**
+ * @brief Matrix of R rows and C columns stored in place
+ * 
+ */
+template <std::size_t R, std::size_t C>
+class FixedMatrix {
+    static_assert(R > 0 && C > 0, "FixedMatrix must have data");
+public:
+
+    /* Constructors */
+
+    /**
+     * @brief Construct FixedMatrix of zeros
+     * 
+     */
+    constexpr FixedMatrix() : _data{} {}
+    /**
+     * @brief Construct FixedMatrix with every element set to value
+     * 
+     */
+    constexpr explicit FixedMatrix(double value) : _data{} {
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] = value;
+    }
+    /**
+     * @brief Construct FixedMatrix from rows
+     * 
+     * @param in {{1,2,3},{4,5,6}} (must be exactly R x C)
+     */
+    constexpr FixedMatrix(std::initializer_list<std::initializer_list<double>>
+                          in) : _data{} {
+        if(in.size() != R)
+            throw std::invalid_argument("Rows must be same size");
+        std::size_t i = 0;
+        for(const std::initializer_list<double>& row : in) {
+            if(row.size() != C)
+                throw std::invalid_argument("Rows must be same size");
+            std::size_t j = 0;
+            for(double value : row)
+                _data[i][j++] = value;
+            ++i;
+        }
+    }
+    /**
+     * @brief Construct FixedMatrix from a Matrix of the same dimentions
+     * 
+     */
+    explicit FixedMatrix(const Matrix& mat) : _data{} {
+        if((std::size_t)mat.num_rows() != R
+           || (std::size_t)mat.num_columns() != C)
+            throw std::invalid_argument(
+                "Matrix must have same dimentions as FixedMatrix");
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] = mat(i, j);
+    }
+    /**
+     * @brief Identity FixedMatrix (square only)
+     * 
+     */
+    static constexpr FixedMatrix identity() {
+        static_assert(R == C, "Matrix must be square");
+        FixedMatrix I;
+        for(std::size_t i=0; i<R; ++i)
+            I._data[i][i] = 1;
+        return I;
+    }
+
+    /**
+     * @brief Copy into a Matrix
+     * 
+     */
+    operator Matrix() const {
+        Matrix mat(R, C);
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                mat(i, j) = _data[i][j];
+        return mat;
+    }
+
+    /* Get functions */
+
+    static constexpr std::size_t num_rows() { return R; }
+    static constexpr std::size_t num_columns() { return C; }
+
+    /**
+     * @brief unchecked element access
+     * 
+     */
+    constexpr double& operator()(std::size_t row, std::size_t col) {
+        return _data[row][col];
+    }
+    constexpr const double& operator()(std::size_t row,
+                                       std::size_t col) const {
+        return _data[row][col];
+    }
+    /**
+     * @brief checked element access
+     * 
+     */
+    constexpr double& at(std::size_t row, std::size_t col) {
+        _check(row, col);
+        return _data[row][col];
+    }
+    constexpr const double& at(std::size_t row, std::size_t col) const {
+        _check(row, col);
+        return _data[row][col];
+    }
+
+    constexpr double* data() { return &_data[0][0]; }
+    constexpr const double* data() const { return &_data[0][0]; }
+
+    /* Binary math functions */
+
+    constexpr bool operator==(const FixedMatrix& other) const {
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                if(_data[i][j] != other._data[i][j])
+                    return false;
+        return true;
+    }
+    constexpr bool operator!=(const FixedMatrix& other) const {
+        return !(*this == other);
+    }
+
+    constexpr FixedMatrix& operator+=(const FixedMatrix& other) {
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] += other._data[i][j];
+        return *this;
+    }
+    constexpr FixedMatrix& operator-=(const FixedMatrix& other) {
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] -= other._data[i][j];
+        return *this;
+    }
+    constexpr FixedMatrix& operator*=(double scale) {
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] *= scale;
+        return *this;
+    }
+    constexpr FixedMatrix& operator/=(double scale) {
+        if(scale == 0)
+            throw std::invalid_argument("scale cannot be zero");
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                _data[i][j] /= scale;
+        return *this;
+    }
+
+    constexpr FixedMatrix operator+(const FixedMatrix& other) const {
+        FixedMatrix sum = *this;
+        return sum += other;
+    }
+    constexpr FixedMatrix operator-(const FixedMatrix& other) const {
+        FixedMatrix difference = *this;
+        return difference -= other;
+    }
+    constexpr FixedMatrix operator*(double scale) const {
+        FixedMatrix product = *this;
+        return product *= scale;
+    }
+    friend constexpr FixedMatrix operator*(double scale,
+                                           const FixedMatrix& rhs) {
+        return rhs * scale;
+    }
+    constexpr FixedMatrix operator/(double scale) const {
+        FixedMatrix quotient = *this;
+        return quotient /= scale;
+    }
+
+    /**
+     * @brief Multiply FixedMatrix objects (dimentions checked at compile
+     *        time)
+     * 
+     */
+    template <std::size_t K>
+    constexpr FixedMatrix<R, K> operator*(const FixedMatrix<C, K>& other)
+            const {
+        FixedMatrix<R, K> product;
+        #pragma GCC unroll 8
+        for(std::size_t i=0; i<R; ++i) {
+            #pragma GCC unroll 8
+            for(std::size_t p=0; p<C; ++p) {
+                const double a = _data[i][p];
+                #pragma GCC unroll 8
+                for(std::size_t j=0; j<K; ++j)
+                    product(i, j) += a * other(p, j);
+            }
+        }
+        return product;
+    }
+
+    /* Uniary math functions */
+
+    constexpr FixedMatrix<C, R> transpose() const {
+        FixedMatrix<C, R> T;
+        for(std::size_t i=0; i<R; ++i)
+            for(std::size_t j=0; j<C; ++j)
+                T(j, i) = _data[i][j];
+        return T;
+    }
+
+    /**
+     * @brief returns determinate of FixedMatrix (closed form up to 4x4,
+     *        elimination with partial pivoting above)
+     * 
+     */
+    constexpr double determinant() const {
+        static_assert(R == C, "Matrix must be square");
+        const auto& a = _data;
+        if constexpr(R == 1) {
+            return a[0][0];
+        } else if constexpr(R == 2) {
+            return a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        } else if constexpr(R == 3) {
+            return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+                 - a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+                 + a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        } else if constexpr(R == 4) {
+            _Minors4 m = _minors4();
+            return m.s[0] * m.c[5] - m.s[1] * m.c[4] + m.s[2] * m.c[3]
+                 + m.s[3] * m.c[2] - m.s[4] * m.c[1] + m.s[5] * m.c[0];
+        } else {
+            FixedMatrix M = *this;
+            double det = 1;
+            for(std::size_t k=0; k<R; ++k) {
+                std::size_t pivot = k;
+                for(std::size_t i=k+1; i<R; ++i)
+                    if(_abs(M._data[i][k]) > _abs(M._data[pivot][k]))
+                        pivot = i;
+                if(M._data[pivot][k] == 0)
+                    return 0;
+                if(pivot != k) {
+                    M._swap_rows(pivot, k);
+                    det = -det;
+                }
+                det *= M._data[k][k];
+                for(std::size_t i=k+1; i<R; ++i) {
+                    double coeff = M._data[i][k] / M._data[k][k];
+                    for(std::size_t j=k+1; j<R; ++j)
+                        M._data[i][j] -= coeff * M._data[k][j];
+                }
+            }
+            return det;
+        }
+    }
+
+    /**
+     * @brief returns inverse of FixedMatrix (adjugate up to 4x4, Gauss-Jordan
+     *        with partial pivoting above)
+     * 
+     */
+    constexpr FixedMatrix inverse() const {
+        static_assert(R == C, "Matrix must be square");
+        const auto& a = _data;
+        FixedMatrix inv;
+        if constexpr(R <= 3) {
+            double det = determinant();
+            if(det == 0)
+                throw std::domain_error("Matrix not invertable");
+            if constexpr(R == 1) {
+                inv._data[0][0] = 1 / det;
+            } else if constexpr(R == 2) {
+                inv._data[0][0] = a[1][1] / det;
+                inv._data[0][1] = -a[0][1] / det;
+                inv._data[1][0] = -a[1][0] / det;
+                inv._data[1][1] = a[0][0] / det;
+            } else {
+                #pragma GCC unroll 3
+                for(std::size_t i=0; i<3; ++i) {
+                    #pragma GCC unroll 3
+                    for(std::size_t j=0; j<3; ++j) { // cofactor of (j, i)
+                        std::size_t r0 = (j+1) % 3, r1 = (j+2) % 3;
+                        std::size_t c0 = (i+1) % 3, c1 = (i+2) % 3;
+                        inv._data[i][j] = (a[r0][c0] * a[r1][c1]
+                                           - a[r0][c1] * a[r1][c0]) / det;
+                    }
+                }
+            }
+        } else if constexpr(R == 4) {
+            _Minors4 m = _minors4();
+            const double* s = m.s;
+            const double* c = m.c;
+            double det = s[0] * c[5] - s[1] * c[4] + s[2] * c[3]
+                       + s[3] * c[2] - s[4] * c[1] + s[5] * c[0];
+            if(det == 0)
+                throw std::domain_error("Matrix not invertable");
+            double d = 1 / det;
+            inv._data[0][0] = ( a[1][1]*c[5] - a[1][2]*c[4] + a[1][3]*c[3]) * d;
+            inv._data[0][1] = (-a[0][1]*c[5] + a[0][2]*c[4] - a[0][3]*c[3]) * d;
+            inv._data[0][2] = ( a[3][1]*s[5] - a[3][2]*s[4] + a[3][3]*s[3]) * d;
+            inv._data[0][3] = (-a[2][1]*s[5] + a[2][2]*s[4] - a[2][3]*s[3]) * d;
+            inv._data[1][0] = (-a[1][0]*c[5] + a[1][2]*c[2] - a[1][3]*c[1]) * d;
+            inv._data[1][1] = ( a[0][0]*c[5] - a[0][2]*c[2] + a[0][3]*c[1]) * d;
+            inv._data[1][2] = (-a[3][0]*s[5] + a[3][2]*s[2] - a[3][3]*s[1]) * d;
+            inv._data[1][3] = ( a[2][0]*s[5] - a[2][2]*s[2] + a[2][3]*s[1]) * d;
+            inv._data[2][0] = ( a[1][0]*c[4] - a[1][1]*c[2] + a[1][3]*c[0]) * d;
+            inv._data[2][1] = (-a[0][0]*c[4] + a[0][1]*c[2] - a[0][3]*c[0]) * d;
+            inv._data[2][2] = ( a[3][0]*s[4] - a[3][1]*s[2] + a[3][3]*s[0]) * d;
+            inv._data[2][3] = (-a[2][0]*s[4] + a[2][1]*s[2] - a[2][3]*s[0]) * d;
+            inv._data[3][0] = (-a[1][0]*c[3] + a[1][1]*c[1] - a[1][2]*c[0]) * d;
+            inv._data[3][1] = ( a[0][0]*c[3] - a[0][1]*c[1] + a[0][2]*c[0]) * d;
+            inv._data[3][2] = (-a[3][0]*s[3] + a[3][1]*s[1] - a[3][2]*s[0]) * d;
+            inv._data[3][3] = ( a[2][0]*s[3] - a[2][1]*s[1] + a[2][2]*s[0]) * d;
+        } else {
+            FixedMatrix M = *this;
+            inv = identity();
+            for(std::size_t k=0; k<R; ++k) {
+                std::size_t pivot = k;
+                for(std::size_t i=k+1; i<R; ++i)
+                    if(_abs(M._data[i][k]) > _abs(M._data[pivot][k]))
+                        pivot = i;
+                if(M._data[pivot][k] == 0)
+                    throw std::domain_error("Matrix not invertable");
+                M._swap_rows(pivot, k);
+                inv._swap_rows(pivot, k);
+                double scale = 1 / M._data[k][k];
+                for(std::size_t j=0; j<R; ++j) {
+                    M._data[k][j] *= scale;
+                    inv._data[k][j] *= scale;
+                }
+                for(std::size_t i=0; i<R; ++i) { // sweep every other row
+                    double coeff = M._data[i][k];
+                    if(i == k || coeff == 0)
+                        continue;
+                    for(std::size_t j=0; j<R; ++j) {
+                        M._data[i][j] -= coeff * M._data[k][j];
+                        inv._data[i][j] -= coeff * inv._data[k][j];
+                    }
+                }
+            }
+        }
+        return inv;
+    }
+
+private:
+    double _data[R][C];
+
+    /**
+     * @brief 2x2 minors of the top (s) and bottom (c) two rows of a 4x4,
+     *        shared by its determinant and inverse
+     * 
+     */
+    struct _Minors4 {
+        double s[6];
+        double c[6];
+    };
+    constexpr _Minors4 _minors4() const {
+        const auto& a = _data;
+        return _Minors4{
+            {a[0][0]*a[1][1] - a[1][0]*a[0][1], a[0][0]*a[1][2] - a[1][0]*a[0][2],
+             a[0][0]*a[1][3] - a[1][0]*a[0][3], a[0][1]*a[1][2] - a[1][1]*a[0][2],
+             a[0][1]*a[1][3] - a[1][1]*a[0][3], a[0][2]*a[1][3] - a[1][2]*a[0][3]},
+            {a[2][0]*a[3][1] - a[3][0]*a[2][1], a[2][0]*a[3][2] - a[3][0]*a[2][2],
+             a[2][0]*a[3][3] - a[3][0]*a[2][3], a[2][1]*a[3][2] - a[3][1]*a[2][2],
+             a[2][1]*a[3][3] - a[3][1]*a[2][3], a[2][2]*a[3][3] - a[3][2]*a[2][3]}
+        };
+    }
+
+    static constexpr double _abs(double value) {
+        return value < 0 ? -value : value;
+    }
+    constexpr void _swap_rows(std::size_t r1, std::size_t r2) {
+        for(std::size_t j=0; j<C; ++j) {
+            double tmp = _data[r1][j];
+            _data[r1][j] = _data[r2][j];
+            _data[r2][j] = tmp;
+        }
+    }
+    constexpr void _check(std::size_t row, std::size_t col) const {
+        if(row >= R)
+            throw std::out_of_range("Row does not exist");
+        if(col >= C)
+            throw std::out_of_range("Column does not exist");
+    }
+};
+
+/**
+ * @brief prints FixedMatrix the same way as Matrix
+ * 
+ */
+template <std::size_t R, std::size_t C>
+std::ostream& operator<<(std::ostream& os, const FixedMatrix<R, C>& mat) {
+    return os << Matrix(mat);
+}
+
+typedef FixedMatrix<2, 2> Matrix2;
+typedef FixedMatrix<3, 3> Matrix3;
+typedef FixedMatrix<4, 4> Matrix4;
+
+#endif
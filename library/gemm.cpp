@@ -0,0 +1,280 @@
+#include "kernels.h"
+#include "matrix.h" // MATRIX_ALIGNMENT
+#include <algorithm>
+#include <cstring> // memcpy()
+#include <new> // align_val_t
+
+using namespace std;
+
+#define GEMM_MR 4 // rows of C computed by one microkernel call
+#define GEMM_NR(T) (32 / sizeof(T)) // columns of C per microkernel (256 bits)
+#define GEMM_MC 96 // rows of A packed per block (block sits in L2)
+#define GEMM_KC 256 // depth of packed panels (B micro-panel sits in L1)
+#define GEMM_NC 4096 // columns of B packed per block (panel sits in L3)
+#define GEMM_SMALL_WORK 32768 // m*n*k below which packing does not pay off
+
+#ifndef GEMM_VECTOR_TILE
+#if defined(__GNUC__)
+#define GEMM_VECTOR_TILE 1 // microkernel tile rows are GCC/Clang vector types
+#else
+#define GEMM_VECTOR_TILE 0 // portable array tile
+#endif
+#endif
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief aligned scratch buffer for packed panels, kept between calls so
+ *        steady state multiplies do not allocate
+ * 
+ */
+template <typename T>
+struct _PackBuffer {
+    T* ptr = nullptr;
+    size_t size = 0;
+
+    T* get(size_t count) {
+        if(count > size) {
+            if(ptr)
+                ::operator delete(ptr, align_val_t(MATRIX_ALIGNMENT));
+            ptr = static_cast<T*>(::operator new(
+                count * sizeof(T), align_val_t(MATRIX_ALIGNMENT)));
+            size = count;
+        }
+        return ptr;
+    }
+    ~_PackBuffer() {
+        if(ptr)
+            ::operator delete(ptr, align_val_t(MATRIX_ALIGNMENT));
+    }
+};
+
+/**
+ * @brief copies an mc x kc block of A into MR-row micro-panels, each stored
+ *        column by column (zero padded to a multiple of MR rows)
+ * 
+ */
+template <typename T>
+void _pack_a(size_t mc, size_t kc, const T* A, size_t rsa, size_t csa,
+             T* packed) {
+    for(size_t ir=0; ir<mc; ir+=GEMM_MR) {
+        size_t mr = min<size_t>(GEMM_MR, mc - ir);
+        for(size_t p=0; p<kc; ++p) {
+            const T* a = A + ir*rsa + p*csa;
+            size_t i = 0;
+            for(; i<mr; ++i)
+                packed[i] = a[i*rsa];
+            for(; i<GEMM_MR; ++i)
+                packed[i] = 0;
+            packed += GEMM_MR;
+        }
+    }
+}
+
+/**
+ * @brief copies a kc x nc block of B into NR-column micro-panels, each stored
+ *        row by row (zero padded to a multiple of NR columns)
+ * 
+ */
+template <typename T>
+void _pack_b(size_t kc, size_t nc, const T* B, size_t rsb, size_t csb,
+             T* packed) {
+    constexpr size_t NR = GEMM_NR(T);
+    for(size_t jr=0; jr<nc; jr+=NR) {
+        size_t nr = min<size_t>(NR, nc - jr);
+        for(size_t p=0; p<kc; ++p) {
+            const T* b = B + p*rsb + jr*csb;
+            size_t j = 0;
+            if(csb == 1) {
+                for(; j<nr; ++j)
+                    packed[j] = b[j];
+            } else {
+                for(; j<nr; ++j)
+                    packed[j] = b[j*csb];
+            }
+            for(; j<NR; ++j)
+                packed[j] = 0;
+            packed += NR;
+        }
+    }
+}
+
+/**
+ * @brief multiplies one packed MR x kc micro-panel of A by one packed
+ *        kc x NR micro-panel of B, keeping the MR x NR tile in registers, then
+ *        writes the top-left mr x nr of it to C
+ * 
+ */
+template <typename T>
+void _micro_kernel(size_t kc, const T* a, const T* b, T alpha, T beta, 
+                   T* C, size_t ldc, size_t mr, size_t nr) {
+    constexpr size_t NR = GEMM_NR(T);
+#if GEMM_VECTOR_TILE
+    // one row of the tile as a single SIMD value (a plain T[MR][NR] array is
+    // vectorized poorly for float when AVX-512 is enabled)
+    typedef T TileRow __attribute__((vector_size(NR * sizeof(T))));
+    TileRow ab[GEMM_MR] = {};
+    for(size_t p=0; p<kc; ++p) {
+        TileRow bp;
+        memcpy(&bp, b, sizeof(TileRow));
+        #pragma GCC unroll 8
+        for(size_t i=0; i<GEMM_MR; ++i) {
+            ab[i] += a[i] * bp;
+        }
+        a += GEMM_MR;
+        b += NR;
+    }
+#else
+    T ab[GEMM_MR][NR] = {};
+    for(size_t p=0; p<kc; ++p) {
+        for(size_t i=0; i<GEMM_MR; ++i) {
+            const T ai = a[i];
+            for(size_t j=0; j<NR; ++j)
+                ab[i][j] += ai * b[j];
+        }
+        a += GEMM_MR;
+        b += NR;
+    }
+#endif
+    for(size_t i=0; i<mr; ++i) {
+        T* c = C + i*ldc;
+        if(beta == 0) {
+            for(size_t j=0; j<nr; ++j)
+                c[j] = alpha * ab[i][j];
+        } else {
+            for(size_t j=0; j<nr; ++j)
+                c[j] = alpha * ab[i][j] + beta * c[j];
+        }
+    }
+}
+
+/**
+ * @brief unblocked i-p-j product for matrices too small to amortize packing
+ * 
+ */
+template <typename T>
+void _gemm_small(size_t m, size_t n, size_t k, T alpha,
+                 const T* A, size_t rsa, size_t csa,
+                 const T* B, size_t rsb, size_t csb,
+                 T beta, T* C, size_t ldc) {
+    for(size_t i=0; i<m; ++i) {
+        T* c = C + i*ldc;
+        if(beta == 0) {
+            fill(c, c + n, T(0));
+        } else if(beta != 1) {
+            for(size_t j=0; j<n; ++j)
+                c[j] *= beta;
+        }
+        for(size_t p=0; p<k; ++p) {
+            const T a = alpha * A[i*rsa + p*csa];
+            const T* b = B + p*rsb;
+            for(size_t j=0; j<n; ++j)
+                c[j] += a * b[j*csb];
+        }
+    }
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region GEMM
+
+/**
+ * @brief C = alpha * A * B + beta * C using packed, cache blocked panels
+ * 
+ * Blocking follows the usual five loop layout: an NC wide panel of B is
+ * split into KC deep slices that are packed once and reused for every MC
+ * tall block of A; inside, an MR x NR register tile of C is accumulated by
+ * _micro_kernel() over the full KC depth before touching memory. Packing B
+ * and the (row block, panel range) tasks of C run on the thread pool. NR
+ * follows the element size, so float tiles are twice as wide as double.
+ */
+template <typename T>
+void _gemm(size_t m, size_t n, size_t k, T alpha,
+           const T* A, size_t rsa, size_t csa,
+           const T* B, size_t rsb, size_t csb,
+           T beta, T* C, size_t ldc) {
+    constexpr size_t NR = GEMM_NR(T);
+    if(!m || !n)
+        return;
+    if(!k || alpha == 0) { // only scale C
+        for(size_t i=0; i<m; ++i) {
+            T* c = C + i*ldc;
+            for(size_t j=0; j<n; ++j)
+                c[j] = (beta == 0) ? 0 : beta * c[j];
+        }
+        return;
+    }
+    if(m * n * k <= GEMM_SMALL_WORK) {
+        _gemm_small(m, n, k, alpha, A, rsa, csa, B, rsb, csb, beta, C, ldc);
+        return;
+    }
+
+    static thread_local _PackBuffer<T> bufferB;
+    T* packedB = bufferB.get(GEMM_KC *
+        ((min<size_t>(GEMM_NC, n) + NR - 1) / NR * NR));
+    ThreadPool& pool = ThreadPool::instance();
+    const size_t icBlocks = (m + GEMM_MC - 1) / GEMM_MC;
+
+    for(size_t jc=0; jc<n; jc+=GEMM_NC) {
+        size_t nc = min<size_t>(GEMM_NC, n - jc);
+        size_t panels = (nc + NR - 1) / NR; // NR wide panels of C
+        // split each row block across panels too when there are fewer row
+        // blocks than threads, so wide products still use every thread
+        size_t segments = min(panels, 
+                              max<size_t>(1, 2 * pool.size() / icBlocks));
+        for(size_t pc=0; pc<k; pc+=GEMM_KC) {
+            size_t kc = min<size_t>(GEMM_KC, k - pc);
+            T betaBlock = (pc == 0) ? beta : 1; // accumulate after 1st
+            const T* Bblock = B + pc*rsb + jc*csb;
+            pool.parallel_for(0, panels, 
+                max<size_t>(1, PARALLEL_MIN_WORK / (kc * NR)),
+                [&](size_t lo, size_t hi) {
+                    _pack_b(kc, min(nc, hi*NR) - lo*NR,
+                            Bblock + lo*NR*csb, rsb, csb,
+                            packedB + lo*NR*kc);
+                });
+            // task t computes row block t / segments over its share of panels
+            pool.parallel_for(0, icBlocks * segments, 1,
+                [&](size_t lo, size_t hi) {
+                    static thread_local _PackBuffer<T> bufferA;
+                    T* packedA = bufferA.get(GEMM_MC * GEMM_KC);
+                    size_t packed = m; // row offset of block held in packedA
+                    for(size_t t=lo; t<hi; ++t) {
+                        size_t ic = t / segments * GEMM_MC;
+                        size_t seg = t % segments;
+                        size_t mc = min<size_t>(GEMM_MC, m - ic);
+                        if(packed != ic) {
+                            _pack_a(mc, kc, A + ic*rsa + pc*csa, rsa, csa,
+                                    packedA);
+                            packed = ic;
+                        }
+                        size_t jrEnd = min(nc, 
+                                           panels*(seg+1)/segments * NR);
+                        for(size_t jr=panels*seg/segments * NR; 
+                            jr<jrEnd; jr+=NR) {
+                            size_t nr = min<size_t>(NR, nc - jr);
+                            for(size_t ir=0; ir<mc; ir+=GEMM_MR) {
+                                size_t mr = min<size_t>(GEMM_MR, mc - ir);
+                                _micro_kernel(kc, packedA + ir*kc, 
+                                              packedB + jr*kc, alpha, 
+                                              betaBlock, 
+                                              C + (ic+ir)*ldc + jc + jr, ldc,
+                                              mr, nr);
+                            }
+                        }
+                    }
+                });
+        }
+    }
+}
+
+template void _gemm(size_t m, size_t n, size_t k, double alpha,
+                    const double* A, size_t rsa, size_t csa,
+                    const double* B, size_t rsb, size_t csb,
+                    double beta, double* C, size_t ldc);
+template void _gemm(size_t m, size_t n, size_t k, float alpha,
+                    const float* A, size_t rsa, size_t csa,
+                    const float* B, size_t rsb, size_t csb,
+                    float beta, float* C, size_t ldc);
+
+#pragma endregion // GEMM
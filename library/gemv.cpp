@@ -0,0 +1,54 @@
+#include "kernels.h"
+#include <algorithm>
+
+using namespace std;
+
+#define GEMV_BLOCK 512 // columns of y (and A) one task of A^T * x updates
+
+#pragma region GEMV
+
+/**
+ * @brief y = alpha * op(A) * x + beta * y
+ * 
+ * A * x takes one vectorized dot product per row, with rows spread over the
+ * thread pool. A^T * x adds alpha * x[i] times row i of A into y, so A is
+ * still read row by row; the columns are split into GEMV_BLOCK wide strips
+ * that stay in L1 while every row is swept over them.
+ */
+template <typename T>
+void _gemv(bool transpose, size_t m, size_t n, T alpha, const T* A,
+           size_t lda, const T* x, T beta, T* y, size_t incy) {
+    if(!m || !n)
+        return;
+    if(!transpose) {
+        _for_rows(m, n, [&](size_t lo, size_t hi) {
+            for(size_t i=lo; i<hi; ++i) {
+                T dot = alpha * _simd_dot(n, A + i*lda, 1, x, 1);
+                y[i*incy] = beta == 0 ? dot : dot + beta * y[i*incy];
+            }
+        });
+        return;
+    }
+    size_t strips = (n + GEMV_BLOCK - 1) / GEMV_BLOCK;
+    _for_rows(strips, m * GEMV_BLOCK, [&](size_t lo, size_t hi) {
+        for(size_t s=lo; s<hi; ++s) {
+            size_t j0 = s * GEMV_BLOCK, nj = min<size_t>(GEMV_BLOCK, n - j0);
+            T* ys = y + j0;
+            if(beta == 0)
+                fill(ys, ys + nj, T(0));
+            else if(beta != 1)
+                _simd_scale(nj, beta, ys, ys);
+            for(size_t i=0; i<m; ++i)
+                _simd_axpy(nj, alpha * x[i], A + i*lda + j0, ys, ys);
+        }
+    });
+}
+
+template void _gemv(bool transpose, size_t m, size_t n, double alpha,
+                    const double* A, size_t lda, const double* x,
+                    double beta, double* y, size_t incy);
+template void _gemv(bool transpose, size_t m, size_t n, float alpha,
+                    const float* A, size_t lda, const float* x,
+                    float beta, float* y, size_t incy);
+
+#pragma endregion // GEMV
@@ -0,0 +1,200 @@
+#include "instrument.h"
+#include <algorithm> // max()
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+/* innermost operation running on this thread (nullptr outside any) */
+static thread_local _OpScope* _innermost = nullptr;
+
+/**
+ * @return size bucket of a rows x columns problem: the smallest power of two
+ *         not below its largest dimension
+ */
+inline size_t _size_bucket(size_t rows, size_t columns) {
+    size_t largest = max(rows, columns), bucket = 1;
+    while(bucket < largest)
+        bucket *= 2;
+    return bucket;
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region INSTRUMENTATION
+
+/**
+ * @return statistics shared by all Matrix operations
+ */
+Instrumentation& Instrumentation::instance() {
+    static Instrumentation instrumentation;
+    return instrumentation;
+}
+
+/**
+ * @return true if the library was built with MATRIX_INSTRUMENT
+ */
+bool Instrumentation::enabled() {
+#ifdef MATRIX_INSTRUMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @return totals per operation and size bucket, ordered by name then size
+ */
+vector<OpStats> Instrumentation::snapshot() const {
+    lock_guard<mutex> lock(_mutex);
+    vector<OpStats> stats;
+    stats.reserve(_stats.size());
+    for(const auto& entry : _stats)
+        stats.push_back(entry.second);
+    return stats;
+}
+
+/**
+ * @return event counters by name (e.g. "eigenvalues.sweeps", "inverse.lu",
+ *         "allocations", "bytes_allocated")
+ */
+map<string, uint64_t> Instrumentation::counters() const {
+    lock_guard<mutex> lock(_mutex);
+    return map<string, uint64_t>(_counters.begin(), _counters.end());
+}
+
+/**
+ * @brief clears all statistics and counters (callbacks are kept)
+ *
+ */
+void Instrumentation::reset() {
+    lock_guard<mutex> lock(_mutex);
+    _stats.clear();
+    _counters.clear();
+}
+
+/**
+ * @brief calls callback for every operation finished from now on
+ *
+ * @return id for remove_callback()
+ */
+size_t Instrumentation::add_callback(Callback callback) {
+    lock_guard<mutex> lock(_mutex);
+    auto callbacks = make_shared<_Callbacks>();
+    if(_callbacks)
+        *callbacks = *_callbacks;
+    callbacks->emplace_back(_nextId, move(callback));
+    _callbacks = move(callbacks);
+    return _nextId++;
+}
+/**
+ * @brief stops calling the callback registered under id
+ *
+ */
+void Instrumentation::remove_callback(size_t id) {
+    lock_guard<mutex> lock(_mutex);
+    if(!_callbacks)
+        return;
+    auto callbacks = make_shared<_Callbacks>();
+    for(const auto& entry : *_callbacks)
+        if(entry.first != id)
+            callbacks->push_back(entry);
+    _callbacks = callbacks->empty() ? nullptr : move(callbacks);
+}
+
+/**
+ * @brief adds a finished operation to its totals and passes it to callbacks
+ *
+ */
+void Instrumentation::_record(const OpEvent& event) {
+    shared_ptr<const _Callbacks> callbacks;
+    {
+        lock_guard<mutex> lock(_mutex);
+        _Key key{event.op, _size_bucket(event.rows, event.columns)};
+        auto found = _stats.find(key);
+        if(found == _stats.end()) {
+            found = _stats.emplace(key, OpStats()).first;
+            found->second.op = event.op;
+            found->second.size = key.size;
+        }
+        OpStats& stats = found->second;
+        ++stats.calls;
+        stats.flops += event.flops;
+        stats.bytes += event.bytes;
+        stats.seconds += event.seconds;
+        stats.self_seconds += event.self_seconds;
+        callbacks = _callbacks;
+    }
+    if(callbacks)
+        for(const auto& entry : *callbacks)
+            entry.second(event);
+}
+/**
+ * @brief adds n to the named counter (name must outlive the Instrumentation,
+ *        e.g. a string literal)
+ *
+ */
+void Instrumentation::_count(const char* name, uint64_t n) {
+    lock_guard<mutex> lock(_mutex);
+    _counters[name] += n;
+}
+
+#pragma endregion // INSTRUMENTATION
+/******************************************************************************/
+#pragma region OP_SCOPE
+
+/**
+ * @brief starts timing op and makes it the innermost operation on this thread
+ *
+ */
+_OpScope::_OpScope(const char* op, size_t rows, size_t columns, double flops)
+        : _event{op, rows, columns, flops, 0, 0, 0, 0},
+          _parent(_innermost), _traced(Tracing::active()) {
+    if(_parent)
+        _event.depth = _parent->_event.depth + 1;
+    _innermost = this;
+    _start = chrono::steady_clock::now();
+}
+/**
+ * @brief records the operation and adds its totals to the enclosing one
+ *
+ */
+_OpScope::~_OpScope() {
+    const auto end = chrono::steady_clock::now();
+    _event.seconds = chrono::duration<double>(end - _start).count();
+    _event.self_seconds = _event.seconds - _nestedSeconds;
+    _innermost = _parent;
+    if(_parent) {
+        _parent->_event.flops += _event.flops;
+        _parent->_event.bytes += _event.bytes;
+        _parent->_nestedSeconds += _event.seconds;
+    }
+    if(_traced)
+        Tracing::_complete(_event.op, _start, end, _event.rows,
+                           _event.columns, -1, _event.flops);
+    Instrumentation::instance()._record(_event);
+}
+
+/**
+ * @brief counts flops in the innermost operation on this thread (for work
+ *        only known as it happens, e.g. iterations)
+ *
+ */
+void _OpScope::add_flops(double flops) {
+    if(_innermost)
+        _innermost->_event.flops += flops;
+}
+/**
+ * @brief counts a Matrix storage allocation, in the innermost operation on
+ *        this thread and in the "allocations" and "bytes_allocated" counters
+ *
+ */
+void _OpScope::allocated(size_t bytes) {
+    if(_innermost)
+        _innermost->_event.bytes += bytes;
+    Instrumentation& instrumentation = Instrumentation::instance();
+    instrumentation._count("allocations", 1);
+    instrumentation._count("bytes_allocated", bytes);
+}
+
+#pragma endregion // OP_SCOPE
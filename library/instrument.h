@@ -0,0 +1,157 @@
+#pragma once
+#ifndef MATRIX_INSTRUMENT_H
+#define MATRIX_INSTRUMENT_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "trace.h"
+
+/*
+ * Optional instrumentation of Matrix operations. Build the library (and code
+ * including it) with -DMATRIX_INSTRUMENT to count calls, floating point
+ * operations, bytes of Matrix storage allocated and wall time for every
+ * operation and size; without it the MATRIX_* hooks below expand to nothing
+ * and snapshot() stays empty.
+ *
+ * Nested operations (e.g. the LU factorization inside inverse()) are
+ * reported on their own as well as inside their caller: flops, bytes and
+ * seconds include everything done inside a call, self_seconds excludes time
+ * spent in nested operations. While a trace runs (see trace.h) every
+ * operation is also recorded as a span.
+ */
+
+/**
+ * @brief totals for one operation over calls whose largest dimension falls
+ *        in one size bucket
+ *
+ */
+struct OpStats {
+    std::string op; // operation name, e.g. "multiply" or "lu"
+    std::size_t size; // bucket: largest dimension in (size/2, size]
+    std::uint64_t calls = 0;
+    double flops = 0; // floating point operations (algorithm count)
+    std::uint64_t bytes = 0; // Matrix storage allocated
+    double seconds = 0; // wall time including nested operations
+    double self_seconds = 0; // wall time excluding nested operations
+};
+
+/**
+ * @brief one finished operation, passed to callbacks
+ *
+ */
+struct OpEvent {
+    const char* op;
+    std::size_t rows;
+    std::size_t columns;
+    double flops;
+    std::uint64_t bytes;
+    double seconds;
+    double self_seconds;
+    std::size_t depth; // number of operations this one is nested in
+};
+
+/**
+ * @brief Collected statistics and callbacks for instrumented operations
+ *
+ * All members are thread safe. Callbacks run on the thread that finished the
+ * operation, after its statistics are recorded, and must not add or remove
+ * callbacks.
+ */
+class Instrumentation {
+public:
+
+    typedef std::function<void(const OpEvent&)> Callback;
+
+    static Instrumentation& instance();
+    static bool enabled();
+
+    Instrumentation(const Instrumentation&) = delete;
+    void operator=(const Instrumentation&) = delete;
+
+    std::vector<OpStats> snapshot() const;
+    std::map<std::string, std::uint64_t> counters() const;
+    void reset();
+
+    std::size_t add_callback(Callback callback);
+    void remove_callback(std::size_t id);
+
+    void _record(const OpEvent& event);
+    void _count(const char* name, std::uint64_t n);
+
+private:
+    Instrumentation() = default;
+
+    struct _Key {
+        const char* op;
+        std::size_t size;
+        bool operator<(const _Key& other) const {
+            int order = std::strcmp(op, other.op);
+            return order ? order < 0 : size < other.size;
+        }
+    };
+    struct _NameLess {
+        bool operator()(const char* a, const char* b) const {
+            return std::strcmp(a, b) < 0;
+        }
+    };
+    typedef std::vector<std::pair<std::size_t, Callback>> _Callbacks;
+
+    mutable std::mutex _mutex;
+    std::map<_Key, OpStats> _stats;
+    std::map<const char*, std::uint64_t, _NameLess> _counters;
+    std::shared_ptr<const _Callbacks> _callbacks; // replaced, never modified
+    std::size_t _nextId = 1;
+};
+
+/**
+ * @brief times one operation on the calling thread for as long as it lives
+ *        (see MATRIX_OP)
+ *
+ */
+class _OpScope {
+public:
+    _OpScope(const char* op, std::size_t rows, std::size_t columns,
+             double flops);
+    ~_OpScope();
+    _OpScope(const _OpScope&) = delete;
+    void operator=(const _OpScope&) = delete;
+
+    static void add_flops(double flops);
+    static void allocated(std::size_t bytes);
+
+private:
+    OpEvent _event;
+    std::chrono::steady_clock::time_point _start;
+    double _nestedSeconds = 0;
+    _OpScope* _parent;
+    bool _traced; // a trace was running when the operation started
+};
+
+#ifdef MATRIX_INSTRUMENT
+/* times the rest of the enclosing block as operation op on a rows x columns
+   problem doing flops floating point operations */
+#define MATRIX_OP(op, rows, columns, flops) \
+    _OpScope _matrix_op_scope((op), (rows), (columns), (flops))
+/* adds flops to the innermost operation running on this thread */
+#define MATRIX_ADD_FLOPS(flops) _OpScope::add_flops(flops)
+/* adds n to the named event counter */
+#define MATRIX_COUNT(name, n) Instrumentation::instance()._count((name), (n))
+/* records bytes of Matrix storage allocated */
+#define MATRIX_ALLOCATED(bytes) _OpScope::allocated(bytes)
+#else
+#define MATRIX_OP(op, rows, columns, flops) ((void)0)
+#define MATRIX_ADD_FLOPS(flops) ((void)0)
+#define MATRIX_COUNT(name, n) ((void)0)
+#define MATRIX_ALLOCATED(bytes) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include "thread_pool.h"
+#include "instrument.h"
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/*
+ * Raw compute kernels shared by the Matrix implementation files. These work
+ * on plain row-major pointers with explicit strides and do no argument
+ * checking; they are not part of the public interface.
+ */
+
+/**
+ * @brief checks if value is 0, counting subnormal values as 0 (one compare,
+ *        so loops calling it still vectorize)
+ * 
+ */
+inline bool _is_double_sub_zero(double value) {
+    return std::fabs(value) < std::numeric_limits<double>::min();
+}
+inline bool _is_double_sub_zero(float value) {
+    return std::fabs(value) < std::numeric_limits<float>::min();
+}
+
+/**
+ * @brief instruction sets the vector kernels (_simd_*) can run on
+ * 
+ */
+enum class _SimdLevel {
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+/**
+ * @brief widest instruction set supported by the running CPU (from CPUID),
+ *        chosen once; MATRIX_SIMD=scalar|sse2|avx2 lowers it
+ * 
+ */
+_SimdLevel _simd_level();
+
+/**
+ * @return sum of x[i*incx] * y[i*incy] for i < n (vectorized when both
+ *         strides are 1; the summation order depends on _simd_level())
+ */
+template <typename T>
+T _simd_dot(std::size_t n, const T* x, std::size_t incx,
+            const T* y, std::size_t incy);
+
+/**
+ * @brief z = y + alpha * x for n contiguous elements; z may be x or y
+ * 
+ */
+template <typename T>
+void _simd_axpy(std::size_t n, T alpha, const T* x, const T* y, T* z);
+
+/**
+ * @brief z = alpha * x for n contiguous elements; z may be x
+ * 
+ */
+template <typename T>
+void _simd_scale(std::size_t n, T alpha, const T* x, T* z);
+
+/**
+ * @brief C = alpha * A * B + beta * C
+ * 
+ * A is m x k with element (i,p) at A[i*rsa + p*csa], B is k x n with element
+ * (p,j) at B[p*rsb + j*csb], C is m x n with row stride ldc. When beta == 0
+ * C is never read. Instantiated for float and double.
+ */
+template <typename T>
+void _gemm(std::size_t m, std::size_t n, std::size_t k, T alpha,
+           const T* A, std::size_t rsa, std::size_t csa,
+           const T* B, std::size_t rsb, std::size_t csb,
+           T beta, T* C, std::size_t ldc);
+
+/**
+ * @brief y = alpha * op(A) * x + beta * y, where op(A) is A or A^T
+ * 
+ * A is m x n with row stride lda; x is contiguous, y has stride incy (which
+ * must be 1 when transpose is set). When beta == 0 y is never read.
+ * Instantiated for float and double.
+ */
+template <typename T>
+void _gemv(bool transpose, std::size_t m, std::size_t n, T alpha,
+           const T* A, std::size_t lda, const T* x, T beta, T* y,
+           std::size_t incy);
+
+/**
+ * @brief solves T * X = B for X in place of B
+ * 
+ * T is n x n triangular with element (i,j) at T[i*rst + j*cst]; only the
+ * lower or upper triangle is read, and the diagonal is taken as 1 when unit
+ * is set. B is n x k with row stride ldb. Instantiated for float and double.
+ */
+template <typename S>
+void _trsm(bool lower, bool unit, std::size_t n, std::size_t k,
+           const S* T, std::size_t rst, std::size_t cst,
+           S* B, std::size_t ldb);
+
+/**
+ * @brief B = A^T, where A is rows x columns with row stride lda and B is
+ *        columns x rows with row stride ldb (A and B do not overlap)
+ * 
+ * Instantiated for float and double.
+ */
+template <typename T>
+void _transpose(std::size_t rows, std::size_t columns, const T* A,
+                std::size_t lda, T* B, std::size_t ldb);
+
+/**
+ * @brief A = A^T in place for n x n A with row stride lda. Instantiated for
+ *        float and double.
+ * 
+ */
+template <typename T>
+void _transpose_square(std::size_t n, T* A, std::size_t lda);
+
+/**
+ * @brief reduces n x n A (row stride lda) to upper Hessenberg form with the
+ *        same eigenvalues, using Householder similarity transforms
+ * 
+ */
+void _hessenberg(std::size_t n, double* A, std::size_t lda);
+
+/**
+ * @brief eigenvalues of n x n upper Hessenberg H by Francis double shift QR
+ *        with deflation; H is overwritten
+ * 
+ * A subdiagonal element is treated as zero once it is below tolerance times
+ * its two diagonal neighbours.
+ * 
+ * @return false if max_sweeps QR sweeps did not deflate every eigenvalue
+ */
+bool _hessenberg_eigenvalues(std::size_t n, double* H, std::size_t ldh,
+                             double tolerance, std::size_t max_sweeps,
+                             std::vector<std::complex<double>>& values);
+
+#endif
@@ -0,0 +1,300 @@
+#include "lu.h"
+#include "kernels.h"
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+#include <algorithm> // swap_ranges()
+
+using namespace std;
+
+#define LU_BLOCK 64 // panel width of the blocked factorization
+
+#pragma region CONSTRUCTORS
+
+/**
+ * @brief Factor a square Matrix
+ * 
+ * @param A Matrix to factor (copied)
+ */
+LU::LU(const Matrix& A) : _lu(A) {
+    _factor();
+}
+/**
+ * @brief Factor a square Matrix in place of its storage
+ * 
+ * @param A Matrix to factor (moved from)
+ */
+LU::LU(Matrix&& A) : _lu(move(A)) {
+    _factor();
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region GET_FUNCTIONS
+
+/**
+ * @return true if the Matrix has no inverse (a pivot was zero to within
+ *         rounding error)
+ */
+bool LU::singular() const {
+    return _singular;
+}
+
+/**
+ * @return packed factors: L strictly below the diagonal, U on and above
+ */
+const Matrix& LU::factors() const {
+    return _lu;
+}
+
+/**
+ * @return row permutation; row i of P*A is row permutation()[i] of A
+ */
+const vector<size_t>& LU::permutation() const {
+    return _perm;
+}
+
+/**
+ * @return unit lower triangular factor L
+ */
+Matrix LU::L() const {
+    size_t n = _lu.num_rows();
+    Matrix lower(n);
+    double* l = lower._mutable_data();
+    const size_t ld = lower.leading_dim();
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<i; ++j)
+            l[i*ld + j] = _lu(i, j);
+    return lower;
+}
+/**
+ * @return upper triangular factor U
+ */
+Matrix LU::U() const {
+    size_t n = _lu.num_rows();
+    Matrix upper(n, n);
+    double* u = upper._mutable_data();
+    const size_t ld = upper.leading_dim();
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=i; j<n; ++j)
+            u[i*ld + j] = _lu(i, j);
+    return upper;
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region MATH_FUNCTIONS
+
+/**
+ * @brief returns determinate of factored Matrix
+ * 
+ */
+double LU::determinant() const {
+    if(_singular)
+        return 0;
+    double det = _permSign;
+    for(size_t i=0; i<(size_t)_lu.num_rows(); ++i)
+        det *= _lu(i, i);
+    return det;
+}
+
+/**
+ * @brief returns log of the absolute determinant (does not overflow for
+ *        large matrices); -infinity if singular
+ * 
+ */
+double LU::log_determinant() const {
+    if(_singular)
+        return -numeric_limits<double>::infinity();
+    double sum = 0;
+    for(size_t i=0; i<(size_t)_lu.num_rows(); ++i)
+        sum += log(fabs(_lu(i, i)));
+    return sum;
+}
+
+/**
+ * @brief returns sign of the determinant (-1, 0 or 1)
+ * 
+ */
+int LU::sign() const {
+    if(_singular)
+        return 0;
+    int sign = _permSign;
+    for(size_t i=0; i<(size_t)_lu.num_rows(); ++i)
+        if(_lu(i, i) < 0)
+            sign = -sign;
+    return sign;
+}
+
+/**
+ * @brief returns inverse of factored Matrix
+ * 
+ */
+Matrix LU::inverse() const {
+    return solve(Matrix((size_t)_lu.num_rows()));
+}
+
+/**
+ * @brief Solves A * X = B for X
+ * 
+ * @param B right hand sides, one per column (rows must match A)
+ */
+Matrix LU::solve(const Matrix& B) const {
+    Matrix X(B);
+    solve_in_place(X._mutable_view());
+    return X;
+}
+/**
+ * @brief Solves A * x = b for x
+ * 
+ * @param b right hand side (size must match rows of A)
+ */
+vector<double> LU::solve(const vector<double>& b) const {
+    vector<double> x(b);
+    solve_in_place(x);
+    return x;
+}
+
+/**
+ * @brief Solves A * X = B, overwriting B with X (no allocation unless B is a
+ *        view with strided columns)
+ * 
+ * @param B right hand sides, one per column (rows must match A)
+ */
+void LU::solve_in_place(MatrixView B) const {
+    _check_solve(B.rows());
+    if(B.column_stride() != 1) { // substitution needs contiguous rows
+        Matrix X(B);
+        _substitute(X._mutable_data(), X.num_columns(), X.leading_dim());
+        B = X;
+        return;
+    }
+    _substitute(B.data(), B.columns(), B.row_stride());
+}
+/**
+ * @brief Solves A * x = b, overwriting b with x (no allocation)
+ * 
+ * @param b right hand side (size must match rows of A)
+ */
+void LU::solve_in_place(vector<double>& b) const {
+    _check_solve(b.size());
+    _substitute(b.data(), 1, 1);
+}
+
+#pragma endregion // MATH_FUNCTIONS
+/******************************************************************************/
+#pragma region FACTORIZATION
+
+/**
+ * @brief blocked right-looking elimination: factor a LU_BLOCK wide panel,
+ *        solve for the matching block row of U, then update the trailing
+ *        submatrix with one large multiply through _gemm()
+ * 
+ */
+void LU::_factor() {
+    if(_lu.empty())
+        throw invalid_argument("Matrix must have data");
+    if(_lu.num_rows() != _lu.num_columns())
+        throw invalid_argument("Matrix must be square");
+    const size_t n = _lu.num_rows();
+    const size_t ld = _lu.leading_dim();
+    MATRIX_OP("lu", n, n, 2.0 / 3.0 * n * n * n);
+    double* a = _lu._mutable_data();
+    _perm.resize(n);
+    _pivots.resize(n);
+    for(size_t i=0; i<n; ++i)
+        _perm[i] = i;
+    // pivots within rounding error of zero leave the Matrix numerically
+    // singular: elimination error is about n * eps * max|A|
+    double maxAbs = 0;
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<n; ++j)
+            maxAbs = max(maxAbs, fabs(a[i*ld + j]));
+    _tolerance = n * numeric_limits<double>::epsilon() * maxAbs;
+
+    for(size_t k0=0; k0<n; k0+=LU_BLOCK) {
+        const size_t nb = min<size_t>(LU_BLOCK, n - k0);
+        const size_t k1 = k0 + nb; // first column right of the panel
+        _factor_panel(k0, nb);
+        if(k1 == n)
+            break;
+        MATRIX_TRACE_SPAN("lu update", n - k1, n - k1, (long)k0);
+        // U12 = L11^-1 * A12
+        _trsm(true, true, nb, n - k1, a + k0*ld + k0, ld, 1,
+              a + k0*ld + k1, ld);
+        // A22 -= L21 * U12
+        _gemm(n - k1, n - k1, nb, -1.0, a + k1*ld + k0, ld, 1,
+              a + k0*ld + k1, ld, 1, 1.0, a + k1*ld + k1, ld);
+    }
+}
+
+/**
+ * @brief unblocked elimination with partial pivoting of columns
+ *        [k0, k0+nb) over rows [k0, n); row swaps are applied to whole rows
+ * 
+ */
+void LU::_factor_panel(size_t k0, size_t nb) {
+    const size_t n = _lu.num_rows();
+    const size_t ld = _lu.leading_dim();
+    double* a = _lu._mutable_data();
+    const size_t k1 = k0 + nb;
+    MATRIX_TRACE_SPAN("lu panel", n - k0, nb, (long)k0);
+    for(size_t j=k0; j<k1; ++j) {
+        MATRIX_TRACE_SPAN("lu column", n - j, k1 - j, (long)j);
+        size_t pivotRow = j; // largest magnitude in column j at or below j
+        double pivotMax = fabs(a[j*ld + j]);
+        for(size_t i=j+1; i<n; ++i) {
+            if(fabs(a[i*ld + j]) > pivotMax) {
+                pivotMax = fabs(a[i*ld + j]);
+                pivotRow = i;
+            }
+        }
+        _pivots[j] = pivotRow;
+        if(pivotRow != j) {
+            _lu.swap_row(pivotRow, j);
+            swap(_perm[pivotRow], _perm[j]);
+            _permSign = -_permSign;
+        }
+        if(pivotMax <= _tolerance) { // nothing left to eliminate
+            _singular = true;
+            continue;
+        }
+        const double* pivot = a + j*ld;
+        for(size_t i=j+1; i<n; ++i) { // sweep rows below within the panel
+            double* row = a + i*ld;
+            const double l = (row[j] /= pivot[j]);
+            if(l == 0)
+                continue;
+            _simd_axpy(k1 - j - 1, -l, pivot + j + 1, row + j + 1, row + j + 1);
+        }
+    }
+}
+
+/**
+ * @brief throws if the factored Matrix cannot be solved against a right hand
+ *        side with given rows
+ * 
+ */
+void LU::_check_solve(size_t rows) const {
+    if(_singular)
+        throw domain_error("Matrix is singular");
+    if(rows != (size_t)_lu.num_rows())
+        throw invalid_argument("Right hand side must have same rows as Matrix");
+}
+
+/**
+ * @brief applies the row swaps to B, then forward substitution with L and
+ *        back substitution with U
+ * 
+ */
+void LU::_substitute(double* B, size_t k, size_t ldb) const {
+    const size_t n = _lu.num_rows();
+    MATRIX_OP("lu_solve", n, k, 2.0 * n * n * k);
+    for(size_t j=0; j<n; ++j)
+        if(_pivots[j] != j)
+            swap_ranges(B + j*ldb, B + j*ldb + k, B + _pivots[j]*ldb);
+    _trsm(true, true, n, k, _lu.data(), _lu.leading_dim(), 1, B, ldb);
+    _trsm(false, false, n, k, _lu.data(), _lu.leading_dim(), 1, B, ldb);
+}
+
+#pragma endregion // FACTORIZATION
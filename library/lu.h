@@ -0,0 +1,59 @@
+#pragma once
+#ifndef MATRIX_LU_H
+#define MATRIX_LU_H
+
+#include "matrix.h"
+#include <vector>
+
+/**
+ * @brief LU factorization with partial pivoting, P * A = L * U
+ * 
+ * Factor once, then query the determinant, inverse or solve against as many
+ * right hand sides as needed without repeating the O(n^3) elimination.
+ * solve_in_place() overwrites the right hand sides with the solution and does
+ * not allocate, for solving against one system in a tight loop; B may be a
+ * view, e.g. a block of columns of a larger Matrix.
+ * L (unit lower) and U are packed into one n x n Matrix.
+ */
+class LU {
+public:
+
+    /* Constructors */
+
+    LU(const Matrix& A);
+    LU(Matrix&& A);
+
+    /* Get functions */
+
+    bool singular() const;
+    const Matrix& factors() const;
+    const std::vector<std::size_t>& permutation() const;
+    Matrix L() const;
+    Matrix U() const;
+
+    /* Math functions */
+
+    double determinant() const;
+    double log_determinant() const;
+    int sign() const;
+    Matrix inverse() const;
+    Matrix solve(const Matrix& B) const;
+    std::vector<double> solve(const std::vector<double>& b) const;
+    void solve_in_place(MatrixView B) const;
+    void solve_in_place(std::vector<double>& b) const;
+
+private:
+    Matrix _lu; // L below the diagonal (unit diagonal implied), U on and above
+    std::vector<std::size_t> _perm; // row i of P*A is row _perm[i] of A
+    std::vector<std::size_t> _pivots; // row swapped with row j at step j
+    int _permSign = 1; // sign of the permutation (+1 or -1)
+    double _tolerance = 0; // pivots at or below this count as zero
+    bool _singular = false; // true if any pivot is zero
+
+    void _factor();
+    void _factor_panel(std::size_t k0, std::size_t nb);
+    void _check_solve(std::size_t rows) const;
+    void _substitute(double* B, std::size_t k, std::size_t ldb) const;
+};
+
+#endif
@@ -1,26 +1,195 @@
 #include "matrix.h"
+#include "kernels.h"
 #include <stdexcept>
 #include <iomanip>
+#include <fstream>
 #include <cmath> // sqrt()
+#include <cstring> // memcpy(), memmove(), memset()
+#include <new> // align_val_t, placement new
+#include <atomic>
 #include <type_traits>
+#include <algorithm> // stable_sort()
 
 using namespace std;
 
 #define DEF_FLOAT_LEN 4 // default float length
 #define MAX_FLOAT_LEN 12 // max float length
-#define MAX_MATRIX_SIZE 0x20000000 // 2^29
 
 bool NICE_BRACKET = false;
 
 #pragma region PRIVATE_FUNCTONS
 
 /**
- * @brief checks if double is 0 (counting subnormal variables as 0)
+ * @brief row stride for a row of given length, rounded up to a whole number of
+ *        cache lines (rows that are a multiple of 4KiB apart get one extra line
+ *        so walking down a column does not thrash a single cache set)
+ * 
+ * Rows shorter than a cache line (column vectors, tall skinny data) are not
+ * padded: padding them would multiply their memory and put every element on
+ * a line of its own.
+ * 
+ * @param size bytes per element
+ */
+size_t _padded_ld(size_t columns, size_t size) {
+    const size_t lane = MATRIX_ALIGNMENT / size;
+    if(columns < lane)
+        return columns;
+    size_t ld = (columns + lane - 1) / lane * lane;
+    if(ld * size >= 4096 && (ld * size) % 4096 == 0)
+        ld += lane;
+    return ld;
+}
+
+/**
+ * @brief allocates MATRIX_ALIGNMENT aligned storage for count elements,
+ *        behind a header holding its reference count (starts at 1)
+ * 
+ */
+template <typename T>
+T* _alloc_buffer(size_t count, bool zero) {
+    if(!count)
+        return nullptr;
+    char* base = static_cast<char*>(::operator new(
+        MATRIX_ALIGNMENT + count * sizeof(T), align_val_t(MATRIX_ALIGNMENT)));
+    new (base) atomic<size_t>(1);
+    T* ptr = reinterpret_cast<T*>(base + MATRIX_ALIGNMENT);
+    if(zero)
+        memset(ptr, 0, count * sizeof(T));
+    MATRIX_ALLOCATED(count * sizeof(T));
+    return ptr;
+}
+/**
+ * @brief adds a reference to storage from _alloc_buffer()
+ * 
+ */
+void _share_buffer(const void* ptr) {
+    if(ptr)
+        _buffer_refs(ptr).fetch_add(1, memory_order_relaxed);
+}
+/**
+ * @brief drops a reference to storage from _alloc_buffer(), freeing it with
+ *        the last one
  * 
  */
-bool _is_double_sub_zero(double value) {
-    return (fpclassify(value) == FP_SUBNORMAL) 
-            || (fpclassify(value) == FP_ZERO);
+void _free_buffer(const void* ptr) {
+    if(!ptr || _buffer_refs(ptr).fetch_sub(1, memory_order_acq_rel) != 1)
+        return;
+    ::operator delete(const_cast<char*>(static_cast<const char*>(ptr)) 
+                      - MATRIX_ALIGNMENT, align_val_t(MATRIX_ALIGNMENT));
+}
+
+/**
+ * @brief cheap test for Matrix that could be symmetric positive definite
+ *        (square, exactly symmetric, positive diagonal), worth trying
+ *        Cholesky on before falling back to LU
+ * 
+ */
+bool _maybe_spd(const Matrix& mat) {
+    size_t n = mat.num_rows();
+    if((size_t)mat.num_columns() != n)
+        return false;
+    for(size_t i=0; i<n; ++i) {
+        if(!(mat(i, i) > 0))
+            return false;
+        for(size_t j=0; j<i; ++j)
+            if(mat(i, j) != mat(j, i))
+                return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Matrix as double precision for the double only factorizations
+ *        (no copy when it already is)
+ * 
+ */
+const Matrix& _widen(const Matrix& mat) {
+    return mat;
+}
+template <typename Scalar>
+Matrix _widen(const BasicMatrix<Scalar>& mat) {
+    return Matrix(mat);
+}
+/**
+ * @brief vector as double precision (no copy when it already is)
+ * 
+ */
+const vector<double>& _widen(const vector<double>& values) {
+    return values;
+}
+template <typename Scalar>
+vector<double> _widen(const vector<Scalar>& values) {
+    return vector<double>(values.begin(), values.end());
+}
+
+/**
+ * @brief vector in the Matrix element type (no copy when it already is)
+ * 
+ */
+template <typename Scalar>
+const vector<Scalar>& _as_scalar(const vector<Scalar>& values) {
+    return values;
+}
+template <typename Scalar, typename T,
+          typename = typename enable_if<!is_same<Scalar, T>::value>::type>
+vector<Scalar> _as_scalar(const vector<T>& values) {
+    return vector<Scalar>(values.begin(), values.end());
+}
+
+/**
+ * @brief double precision result converted back to Scalar (moved when
+ *        Scalar is double)
+ * 
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> _narrow(Matrix&& mat) {
+    return BasicMatrix<Scalar>(mat);
+}
+template <>
+Matrix _narrow<double>(Matrix&& mat) {
+    return move(mat);
+}
+template <typename Scalar>
+vector<Scalar> _narrow(vector<double>&& values) {
+    return vector<Scalar>(values.begin(), values.end());
+}
+template <>
+vector<double> _narrow<double>(vector<double>&& values) {
+    return move(values);
+}
+
+/**
+ * @brief reads the elements of a Matrix file (stream at its data offset)
+ *        stored as T into rows of dst, ld elements apart, converting byte
+ *        order when swapped and element type when T is not Scalar
+ * 
+ */
+template <typename T, typename Scalar>
+void _read_elements(istream& file, const _MatrixFileHeader& header,
+                    bool swapped, Scalar* dst, size_t ld) {
+    const size_t rows = header.rows, columns = header.columns;
+    const bool same = is_same<T, Scalar>::value;
+    if(same && !swapped && header.row_stride == columns && ld == columns) {
+        if(!file.read(reinterpret_cast<char*>(dst),
+                      rows * columns * sizeof(T)))
+            throw runtime_error("Matrix file is truncated");
+        return;
+    }
+    vector<T> buffer(same ? 0 : columns);
+    const streamoff skip = (header.row_stride - columns) * sizeof(T);
+    for(size_t i=0; i<rows; ++i) {
+        T* row = same ? reinterpret_cast<T*>(dst + i*ld) : buffer.data();
+        if(!file.read(reinterpret_cast<char*>(row), columns * sizeof(T)))
+            throw runtime_error("Matrix file is truncated");
+        if(swapped)
+            for(size_t j=0; j<columns; ++j)
+                row[j] = _byteswap(row[j]);
+        if(!same)
+            for(size_t j=0; j<columns; ++j)
+                dst[i*ld + j] = (Scalar)row[j];
+        if(skip && i+1 < rows)
+            file.seekg(skip, ios::cur);
+    }
 }
 
 #pragma endregion // PRIVATE_FUNCTONS
@@ -31,7 +200,8 @@ bool _is_double_sub_zero(double value) {
  * @brief Construct an empty Matrix
  * 
  */
-Matrix::Matrix() {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix() {
     _rows = 0;
     _columns = 0;
     _floatLen = DEF_FLOAT_LEN;
@@ -43,20 +213,20 @@ Matrix::Matrix() {
  * 
  * @param in list of lists of doubles
  */
-Matrix::Matrix(initializer_list<initializer_list<double>> in) {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(
+        initializer_list<initializer_list<double>> in) {
     if(in.size()) { // if 'in' is not empty
-        _columns = in.begin()->size(); // sets columns to size of first list
-        _rows = 0;
+        size_t columns = in.begin()->size(); // size of first list
         for(auto it = in.begin(); it != in.end(); ++it) {
-            if(_columns != it->size()) { // check row length == columns
+            if(columns != it->size()) { // check row length == columns
                 throw invalid_argument("Rows must be same size");
             }
-            vector<double> row;
-            for(auto it2 = it->begin(); it2 != it->end(); ++it2) {
-                row.push_back(*it2);
-            }
-            _data.push_back(row);
-            ++_rows;
+        }
+        _allocate(in.size(), columns);
+        Scalar* dst = _data;
+        for(auto it = in.begin(); it != in.end(); ++it, dst += _ld) {
+            copy(it->begin(), it->end(), dst);
         }
     } else {
         _rows = 0;
@@ -70,21 +240,24 @@ Matrix::Matrix(initializer_list<initializer_list<double>> in) {
  * 
  * @param in vector<vector<T>>
  */
+template <typename Scalar>
 template <typename T>
-Matrix::Matrix(const vector<vector<T>>& in) {
+BasicMatrix<Scalar>::BasicMatrix(const vector<vector<T>>& in) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(in.size() > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(in.size()) { // if not empty
         if(in[0].size() > MAX_MATRIX_SIZE)
             throw out_of_range("size must be less than MAX_MATRIX_SIZE");
-        _columns = in[0].size();
-        for(vector<T> row : in)
-            if(_columns != row.size())
+        size_t columns = in[0].size();
+        for(const vector<T>& row : in)
+            if(columns != row.size())
                 throw invalid_argument("Rows must be same size");
-        _rows = in.size();
-        for(vector<T> row : in) {
-            _data.push_back(vector<double>(row.begin(), row.end()));
+        _allocate(in.size(), columns);
+        Scalar* dst = _data;
+        for(const vector<T>& row : in) {
+            copy(row.begin(), row.end(), dst);
+            dst += _ld;
         }
     } else { // list empty
         _rows = 0;
@@ -100,20 +273,21 @@ Matrix::Matrix(const vector<vector<T>>& in) {
  * @param in list of numbers
  * @param type orientaion of vector: Matrix::column or Matrix::row
  */
-Matrix::Matrix(initializer_list<double> in, orientation type) {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(initializer_list<double> in, 
+                                 orientation type) {
     if(in.size() > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(in.size()) { // if not empty
         if(type == column) {
-            _columns = 1;
-            _rows = in.size();
-            for(auto it = in.begin(); it != in.end(); ++it) {
-                _data.push_back(vector<double>({*it}));
+            _allocate(in.size(), 1);
+            Scalar* dst = _data;
+            for(auto it = in.begin(); it != in.end(); ++it, dst += _ld) {
+                *dst = *it;
             }
         } else if (type == row) {
-            _rows = 1;
-            _columns = in.size();
-            _data.push_back(vector<double>(in.begin(), in.end()));
+            _allocate(1, in.size());
+            copy(in.begin(), in.end(), _data);
         } else
             throw invalid_argument("Invalid orientation parameter");
 
@@ -130,21 +304,21 @@ Matrix::Matrix(initializer_list<double> in, orientation type) {
  * @param in list of numbers
  * @param type orientaion of vector: Matrix::column or Matrix::row
  */
-template <typename T> 
-Matrix::Matrix(const vector<T>& in, orientation type) {
+template <typename Scalar>
+template <typename T>
+BasicMatrix<Scalar>::BasicMatrix(const vector<T>& in, orientation type) {
     if(in.size() > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(in.size()) { // if not empty
         if(type == column) {
-            _columns = 1;
-            _rows = in.size();
-            for(auto it = in.begin(); it != in.end(); ++it) {
-                _data.push_back(vector<double>({(double)*it}));
+            _allocate(in.size(), 1);
+            Scalar* dst = _data;
+            for(auto it = in.begin(); it != in.end(); ++it, dst += _ld) {
+                *dst = (Scalar)*it;
             }
         } else if (type == row) {
-            _rows = 1;
-            _columns = in.size();
-            _data.push_back(vector<double>(in.begin(), in.end()));
+            _allocate(1, in.size());
+            copy(in.begin(), in.end(), _data);
         } else
             throw invalid_argument("Invalid orientation parameter");
 
@@ -157,14 +331,57 @@ Matrix::Matrix(const vector<T>& in, orientation type) {
 }
 
 /**
- * @brief Construct a Matrix with other Matrix
+ * @brief Construct a Matrix with other Matrix (shares its storage until
+ *        either one is written to, unless other is unshareable)
  * 
  * @param other Matrix object
  */
-Matrix::Matrix(const Matrix& other) {
-    _columns = other._columns;
-    _rows = other._rows;
-    _data = other._data;
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(const BasicMatrix& other) {
+    _rows = 0;
+    _columns = 0;
+    if(!other.empty()) {
+        _share(other);
+    }
+    _floatLen = other._floatLen;
+    _floatPrecis = other._floatPrecis;
+    _augment_lines = other._augment_lines;
+}
+/**
+ * @brief Construct a Matrix by taking the storage of other, leaving it empty
+ * 
+ * @param other Matrix object
+ */
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(BasicMatrix&& other) noexcept 
+        : _data(other._data), _unshareable(other._unshareable),
+          _ld(other._ld), _capacity(other._capacity),
+          _rows(other._rows), _columns(other._columns), 
+          _floatLen(other._floatLen), _floatPrecis(other._floatPrecis),
+          _augment_lines(move(other._augment_lines)) {
+    other._data = nullptr;
+    other._release();
+    other._augment_lines.clear();
+}
+
+/**
+ * @brief Construct a Matrix by converting every element of a Matrix of
+ *        another element type (e.g. MatrixF from Matrix)
+ * 
+ * @param other Matrix object
+ */
+template <typename Scalar>
+template <typename U>
+BasicMatrix<Scalar>::BasicMatrix(const BasicMatrix<U>& other) {
+    _rows = 0;
+    _columns = 0;
+    if(!other.empty()) {
+        _allocate(other._rows, other._columns, false);
+        for(size_t i=0; i<_rows; ++i) {
+            copy(other._data + i*other._ld, 
+                 other._data + i*other._ld + _columns, _data + i*_ld);
+        }
+    }
     _floatLen = other._floatLen;
     _floatPrecis = other._floatPrecis;
     _augment_lines = other._augment_lines;
@@ -177,17 +394,17 @@ Matrix::Matrix(const Matrix& other) {
  * @param columns number of columns in Matrix
  * @param value value to fill Matrix
  */
-Matrix::Matrix(size_t rows, size_t columns, double value) {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(size_t rows, size_t columns, Scalar value) {
     if(rows > MAX_MATRIX_SIZE || columns > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(columns == 0 || rows == 0) {
         _rows = 0;
         _columns = 0;
     } else {
-        _rows = rows;
-        _columns = columns;
+        _allocate(rows, columns);
         for(size_t i=0; i<rows; ++i) {
-            _data.push_back(vector<double>(columns, value));
+            fill(_data + i*_ld, _data + i*_ld + columns, value);
         }
     }
     _floatLen = DEF_FLOAT_LEN;
@@ -199,18 +416,15 @@ Matrix::Matrix(size_t rows, size_t columns, double value) {
  * @param rows number of rows in Matrix
  * @param columns number of columns in Matrix
  */
-Matrix::Matrix(size_t rows, size_t columns) {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(size_t rows, size_t columns) {
     if(rows > MAX_MATRIX_SIZE || columns > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(columns == 0 || rows == 0) {
         _rows = 0;
         _columns = 0;
     } else {
-        _rows = rows;
-        _columns = columns;
-        for(size_t i=0; i<rows; ++i) {
-            _data.push_back(vector<double>(columns));
-        }
+        _allocate(rows, columns);
     }
     _floatLen = DEF_FLOAT_LEN;
     _floatPrecis = pow(10, -(DEF_FLOAT_LEN + 1));
@@ -221,21 +435,29 @@ Matrix::Matrix(size_t rows, size_t columns) {
  * 
  * @param identitySize size of rows/columns of identity matrix
  */
-Matrix::Matrix(size_t identitySize) {
+template <typename Scalar>
+BasicMatrix<Scalar>::BasicMatrix(size_t identitySize) {
     if(identitySize > MAX_MATRIX_SIZE)
         throw out_of_range("size must be less than MAX_MATRIX_SIZE");
     if(!identitySize) // if == 0
         throw invalid_argument("identity size must be greater than 0");
-    _rows = identitySize;
-    _columns = identitySize;
+    _allocate(identitySize, identitySize);
     for(size_t i=0; i<identitySize; ++i) {
-        _data.push_back(vector<double>(identitySize));
-        _data[i][i] = 1;
+        _data[i*_ld + i] = 1;
     }
     _floatLen = DEF_FLOAT_LEN;
     _floatPrecis = pow(10, -(DEF_FLOAT_LEN + 1));
 }
 
+/**
+ * @brief Destroy the Matrix and free its storage
+ * 
+ */
+template <typename Scalar>
+BasicMatrix<Scalar>::~BasicMatrix() {
+    _release();
+}
+
 #pragma endregion // CONTSRUCTORS
 /******************************************************************************/
 #pragma region GET_FUNCTIONS
@@ -243,50 +465,51 @@ Matrix::Matrix(size_t identitySize) {
 /**
  * @return Number of rows in Matrix
  */
-int Matrix::num_rows() const {
+template <typename Scalar>
+int BasicMatrix<Scalar>::num_rows() const {
     return _rows;
 }
 /**
  * @return Number of columns in Matrix
  */
-int Matrix::num_columns() const {
+template <typename Scalar>
+int BasicMatrix<Scalar>::num_columns() const {
     return _columns;
 }
 
 /**
  * @param row row of Matrix to retrieve
- * @return vector<double> of row
+ * @return vector<Scalar> of row
  */
-vector<double> Matrix::get_row(size_t row) const {
+template <typename Scalar>
+vector<Scalar> BasicMatrix<Scalar>::get_row(size_t row) const {
     if(row >= _rows)
         throw out_of_range("Row does not exist");
-    return _data[row];
+    return vector<Scalar>(_data + row*_ld, _data + row*_ld + _columns);
 }
 /**
  * @param col column of Matrix to retrieve
- * @return vector<double> of column
+ * @return vector<Scalar> of column
  */
-vector<double> Matrix::get_column(size_t col) const {
+template <typename Scalar>
+vector<Scalar> BasicMatrix<Scalar>::get_column(size_t col) const {
     if(col >= _columns)
         throw out_of_range("Column does not exist");
-    vector<double> column;
-    for(vector<double> row : _data) {
-        column.push_back(row[col]);
+    vector<Scalar> column(_rows);
+    for(size_t i=0; i<_rows; ++i) {
+        column[i] = _data[i*_ld + col];
     }
     return column;
 }
 
-vector<double> Matrix::to_vector() const {
+template <typename Scalar>
+vector<Scalar> BasicMatrix<Scalar>::to_vector() const {
     if(empty())
-        return vector<double>();
+        return vector<Scalar>();
     if(_rows == 1) {
-        return _data[0];
+        return get_row(0);
     } else if (_columns == 1) {
-        vector<double> column;
-        for(vector<double> row : _data) {
-            column.push_back(row[0]);
-        }
-        return column;
+        return get_column(0);
     }
     throw invalid_argument("Must be only 1 row or column");
 }
@@ -296,26 +519,129 @@ vector<double> Matrix::to_vector() const {
  * @param col column of Matrix
  * @return value at given row and column
  */
-double& Matrix::at(size_t row, size_t col) {
+template <typename Scalar>
+Scalar& BasicMatrix<Scalar>::at(size_t row, size_t col) {
     if(row >= _rows || col >= _columns)
         throw out_of_range("Index does not exist");
-    return _data[row][col];
+    _unshare();
+    return _data[row*_ld + col];
 }
 
 /**
  * @return size of Matrix (rows * columns)
  */
-int Matrix::size() const {
+template <typename Scalar>
+int BasicMatrix<Scalar>::size() const {
     return _rows * _columns;
 }
 
 /**
  * @return true if Matrix is empty
  */
-bool Matrix::empty() const {
+template <typename Scalar>
+bool BasicMatrix<Scalar>::empty() const {
     return !(_rows || _columns);
 }
 
+/**
+ * @return pointer to first element; row i starts at data() + i*leading_dim()
+ */
+template <typename Scalar>
+Scalar* BasicMatrix<Scalar>::data() {
+    _unshare();
+    return _data;
+}
+/**
+ * @return pointer to first element; row i starts at data() + i*leading_dim()
+ */
+template <typename Scalar>
+const Scalar* BasicMatrix<Scalar>::data() const {
+    return _data;
+}
+/**
+ * @return distance (in elements) between the starts of consecutive rows
+ */
+template <typename Scalar>
+size_t BasicMatrix<Scalar>::leading_dim() const {
+    return _ld;
+}
+
+/**
+ * @return view of the whole Matrix
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrix<Scalar>::view() {
+    return BasicMatrixView<Scalar>(*this);
+}
+/**
+ * @return view of the whole Matrix through _mutable_data(), for the library
+ *         to write a result it owns (the Matrix stays shareable)
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrix<Scalar>::_mutable_view() {
+    return BasicMatrixView<Scalar>(_mutable_data(), _rows, _columns, _ld);
+}
+/**
+ * @return read only view of the whole Matrix
+ */
+template <typename Scalar>
+BasicMatrixView<const Scalar> BasicMatrix<Scalar>::view() const {
+    return BasicMatrixView<const Scalar>(*this);
+}
+/**
+ * @return view of a row, without copying it (see get_row())
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrix<Scalar>::row_view(size_t row) {
+    return view().row_view(row);
+}
+/**
+ * @return read only view of a row, without copying it (see get_row())
+ */
+template <typename Scalar>
+BasicMatrixView<const Scalar> BasicMatrix<Scalar>::row_view(size_t row) const {
+    return view().row_view(row);
+}
+/**
+ * @return view of a column, without copying it (see get_column())
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrix<Scalar>::column_view(size_t col) {
+    return view().column_view(col);
+}
+/**
+ * @return read only view of a column, without copying it (see get_column())
+ */
+template <typename Scalar>
+BasicMatrixView<const Scalar> 
+BasicMatrix<Scalar>::column_view(size_t col) const {
+    return view().column_view(col);
+}
+/**
+ * @brief view of the rows x columns block starting at (row, col)
+ * 
+ * @param rowStep take every rowStep-th row (1 for a contiguous block)
+ * @param colStep take every colStep-th column (1 for a contiguous block)
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> 
+BasicMatrix<Scalar>::block(size_t row, size_t col, size_t rows, 
+                           size_t columns, size_t rowStep, size_t colStep) {
+    return view().block(row, col, rows, columns, rowStep, colStep);
+}
+/**
+ * @brief read only view of the rows x columns block starting at (row, col)
+ * 
+ * @param rowStep take every rowStep-th row (1 for a contiguous block)
+ * @param colStep take every colStep-th column (1 for a contiguous block)
+ */
+template <typename Scalar>
+BasicMatrixView<const Scalar> 
+BasicMatrix<Scalar>::block(size_t row, size_t col, size_t rows, size_t columns,
+                           size_t rowStep, size_t colStep) const {
+    return view().block(row, col, rows, columns, rowStep, colStep);
+}
+
 #pragma endregion // GET_FUNCTIONS
 /******************************************************************************/
 #pragma region EDIT_FUNCTIONS
@@ -325,7 +651,8 @@ bool Matrix::empty() const {
  * 
  * @param row list of doubles
  */
-void Matrix::push_back_row(const initializer_list<double>& row) {    
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_row(const initializer_list<double>& row) {
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
     if(row.begin() == row.end())
@@ -334,7 +661,8 @@ void Matrix::push_back_row(const initializer_list<double>& row) {
         _columns = row.size();
     else if(_columns != row.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data.push_back(row);
+    _reserve(_rows + 1, _columns);
+    copy(row.begin(), row.end(), _data + _rows*_ld);
     ++_rows;
 }
 /**
@@ -342,8 +670,9 @@ void Matrix::push_back_row(const initializer_list<double>& row) {
  * 
  * @param row vector
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::push_back_row(const vector<T>& row) {
+void BasicMatrix<Scalar>::push_back_row(const vector<T>& row) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
@@ -353,7 +682,8 @@ void Matrix::push_back_row(const vector<T>& row) {
         _columns = row.size();
     else if(_columns != row.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data.push_back(vector<double>(row.begin(), row.end()));
+    _reserve(_rows + 1, _columns);
+    copy(row.begin(), row.end(), _data + _rows*_ld);
     ++_rows;
 }
 /**
@@ -361,27 +691,23 @@ void Matrix::push_back_row(const vector<T>& row) {
  * 
  * @param value containts of new row
  */
-void Matrix::push_back_row(double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_row(Scalar value) {
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
     if(empty())
         throw domain_error("Must have data to add row without size");
-    vector<double> row(_columns, value);
-    _data.push_back(row);
+    _reserve(_rows + 1, _columns);
+    fill(_data + _rows*_ld, _data + _rows*_ld + _columns, value);
     ++_rows;
 }
 /**
  * @brief Adds blank row at bottom of Matrix
  * 
  */
-void Matrix::push_back_row() {
-    if(_rows == MAX_MATRIX_SIZE)
-        throw out_of_range("rows at max size");
-    if(empty())
-        throw domain_error("Must have data to add row without size");
-    vector<double> row(_columns);
-    _data.push_back(row);
-    ++_rows;
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_row() {
+    push_back_row(0.0);
 }
 
 /**
@@ -389,21 +715,22 @@ void Matrix::push_back_row() {
  * 
  * @param col list of doubles
  */
-void Matrix::push_back_column(const initializer_list<double>& col) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_column(
+        const initializer_list<double>& col) {
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
     if(col.begin() == col.end())
         throw invalid_argument("Column cannot be empty");
-    if(empty()) {
+    if(empty())
         _rows = col.size();
-        for(size_t i=0; i<_rows; ++i)
-            _data.push_back(vector<double>());
-    } else if(_rows != col.size())
+    else if(_rows != col.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    size_t index = 0;
-    for(auto iter = col.begin(); iter != col.end(); ++iter) {
-        _data[index++].push_back(*iter);
+    _reserve(_rows, _columns + 1);
+    Scalar* dst = _data + _columns;
+    for(auto iter = col.begin(); iter != col.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
     ++_columns;
 }
@@ -412,24 +739,23 @@ void Matrix::push_back_column(const initializer_list<double>& col) {
  * 
  * @param col vector of ints
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::push_back_column(const vector<T>& col) {
+void BasicMatrix<Scalar>::push_back_column(const vector<T>& col) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
     if(col.empty())
         throw invalid_argument("Column cannot be empty");
-    if(empty()) {
+    if(empty())
         _rows = col.size();
-        for(size_t i=0; i<_rows; ++i)
-            _data.push_back(vector<double>());
-    } else if(_rows != col.size())
+    else if(_rows != col.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    vector<double> colNew;
-    size_t index = 0;
-    for(auto iter = col.begin(); iter != col.end(); ++iter) {
-        _data[index++].push_back(*iter);
+    _reserve(_rows, _columns + 1);
+    Scalar* dst = _data + _columns;
+    for(auto iter = col.begin(); iter != col.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
     ++_columns;
 }
@@ -438,13 +764,15 @@ void Matrix::push_back_column(const vector<T>& col) {
  * 
  * @param value containts of new row
  */
-void Matrix::push_back_column(double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_column(Scalar value) {
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
     if(empty())
         throw domain_error("Must have data to add column without size");
-    for(auto iter = _data.begin(); iter != _data.end(); ++iter) {
-        iter->push_back(value);
+    _reserve(_rows, _columns + 1);
+    for(size_t i=0; i<_rows; ++i) {
+        _data[i*_ld + _columns] = value;
     }
     ++_columns;
 }
@@ -452,15 +780,9 @@ void Matrix::push_back_column(double value) {
  * @brief Adds blank column at right edge of Matrix
  * 
  */
-void Matrix::push_back_column() {
-    if(_columns == MAX_MATRIX_SIZE)
-        throw out_of_range("columns at max size");
-    if(empty())
-        throw domain_error("Must have data to add column without size");
-    for(auto iter = _data.begin(); iter != _data.end(); ++iter) {
-        iter->push_back(0);
-    }
-    ++_columns;
+template <typename Scalar>
+void BasicMatrix<Scalar>::push_back_column() {
+    push_back_column(0.0);
 }
 
 /**
@@ -469,12 +791,15 @@ void Matrix::push_back_column() {
  * @param row row index of Matrix
  * @param rowNew new row (list)
  */
-void Matrix::set_row(size_t row, const initializer_list<double>& rowNew) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_row(size_t row, 
+                                  const initializer_list<double>& rowNew) {
     if(row >= _rows)
         throw out_of_range("Row does not exist");
     if(_columns != rowNew.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data[row] = rowNew;
+    _detach();
+    copy(rowNew.begin(), rowNew.end(), _data + row*_ld);
 }
 /**
  * @brief Replace row of Matrix at given index
@@ -482,14 +807,16 @@ void Matrix::set_row(size_t row, const initializer_list<double>& rowNew) {
  * @param row row index of Matrix
  * @param rowNew new row (vector<int>)
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::set_row(size_t row, const vector<T>& rowNew) {
+void BasicMatrix<Scalar>::set_row(size_t row, const vector<T>& rowNew) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(row >= _rows)
         throw out_of_range("Row does not exist");
     if(_columns != rowNew.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data[row] = vector<double>(rowNew.begin(), rowNew.end());
+    _detach();
+    copy(rowNew.begin(), rowNew.end(), _data + row*_ld);
 }
 /**
  * @brief Replace row of Matrix at given index
@@ -497,24 +824,21 @@ void Matrix::set_row(size_t row, const vector<T>& rowNew) {
  * @param row row index of Matrix
  * @param value values in new row
  */
-void Matrix::set_row(size_t row, double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_row(size_t row, Scalar value) {
     if(row >= _rows)
         throw out_of_range("Row does not exist");
-    for(size_t i=0; i<_columns; ++i) {
-        _data[row][i] = value;
-    }
+    _detach();
+    fill(_data + row*_ld, _data + row*_ld + _columns, value);
 }
 /**
  * @brief Replace row of Matrix with 0's at given index
  * 
  * @param row row index of Matrix
  */
-void Matrix::set_row(size_t row) {
-    if(row >= _rows)
-        throw out_of_range("Row does not exist");
-    for(size_t i=0; i<_columns; ++i) {
-        _data[row][i] = 0;
-    }
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_row(size_t row) {
+    set_row(row, 0.0);
 }
 
 /**
@@ -523,15 +847,18 @@ void Matrix::set_row(size_t row) {
  * @param col column index of Matrix
  * @param colNew new column (list)
  */
-void Matrix::set_column(size_t col, const initializer_list<double>& colNew){
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_column(size_t col, 
+                                     const initializer_list<double>& colNew){
     if(col >= _columns)
         throw out_of_range("Column does not exist");
     if(_rows != colNew.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    size_t index = 0;
-    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter) {
-        _data[index++][col] = *iter;
+    _detach();
+    Scalar* dst = _data + col;
+    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
 }
 /**
@@ -540,17 +867,19 @@ void Matrix::set_column(size_t col, const initializer_list<double>& colNew){
  * @param col column index of Matrix
  * @param colNew new column (vector<int>)
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::set_column(size_t col, const vector<T>& colNew){
+void BasicMatrix<Scalar>::set_column(size_t col, const vector<T>& colNew){
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(col >= _columns)
         throw out_of_range("Column does not exist");
     if(_rows != colNew.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    size_t index = 0;
-    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter) {
-        _data[index++][col] = *iter;
+    _detach();
+    Scalar* dst = _data + col;
+    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
 }
 /**
@@ -559,11 +888,13 @@ void Matrix::set_column(size_t col, const vector<T>& colNew){
  * @param col column index of Matrix
  * @param value values in new column
  */
-void Matrix::set_column(size_t col, double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_column(size_t col, Scalar value) {
     if(col >= _columns)
         throw out_of_range("Column does not exist");
+    _detach();
     for(size_t i=0; i<_rows; ++i) {
-        _data[i][col] = value;
+        _data[i*_ld + col] = value;
     }
 }
 /**
@@ -571,12 +902,9 @@ void Matrix::set_column(size_t col, double value) {
  * 
  * @param col column index of Matrix
  */
-void Matrix::set_column(size_t col) {
-    if(col >= _columns)
-        throw out_of_range("Column does not exist");
-    for(size_t i=0; i<_rows; ++i) {
-        _data[i][col] = 0;
-    }
+template <typename Scalar>
+void BasicMatrix<Scalar>::set_column(size_t col) {
+    set_column(col, 0.0);
 }
 
 /**
@@ -585,15 +913,17 @@ void Matrix::set_column(size_t col) {
  * @param row index of Matrix to insert row
  * @param rowNew new row (list)
  */
-void Matrix::insert_row(size_t row, const initializer_list<double>& rowNew) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_row(size_t row, 
+                                     const initializer_list<double>& rowNew) {
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
     if(row >= _rows)
         throw out_of_range("Row does not exist");
     if(_columns != rowNew.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data.insert(_data.begin() + row, rowNew);
-    ++_rows;
+    insert_row(row);
+    copy(rowNew.begin(), rowNew.end(), _data + row*_ld);
 }
 /**
  * @brief Insert row at index and shift rows below
@@ -601,8 +931,9 @@ void Matrix::insert_row(size_t row, const initializer_list<double>& rowNew) {
  * @param row index of Matrix to insert row
  * @param rowNew new row (vector<int>)
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::insert_row(size_t row, const vector<T>& rowNew) {
+void BasicMatrix<Scalar>::insert_row(size_t row, const vector<T>& rowNew) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
@@ -610,9 +941,8 @@ void Matrix::insert_row(size_t row, const vector<T>& rowNew) {
         throw out_of_range("Row does not exist");
     if(_columns != rowNew.size())
         throw invalid_argument("Row must be same size as Matrix rows");
-    _data.insert(_data.begin() + row, 
-                 vector<double>(rowNew.begin(), rowNew.end()));
-    ++_rows;
+    insert_row(row);
+    copy(rowNew.begin(), rowNew.end(), _data + row*_ld);
 }
 /**
  * @brief Insert row of values at index and shift rows below
@@ -620,12 +950,16 @@ void Matrix::insert_row(size_t row, const vector<T>& rowNew) {
  * @param row index of Matrix to insert row
  * @param value value to fill row
  */
-void Matrix::insert_row(size_t row, double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_row(size_t row, Scalar value) {
     if(_rows == MAX_MATRIX_SIZE)
         throw out_of_range("rows at max size");
     if(row >= _rows)
         throw out_of_range("Row does not exist");
-    _data.insert(_data.begin() + row, vector<double>(_columns, value));
+    _reserve(_rows + 1, _columns);
+    memmove(_data + (row+1)*_ld, _data + row*_ld,
+            (_rows - row) * _ld * sizeof(Scalar));
+    fill(_data + row*_ld, _data + row*_ld + _columns, value);
     ++_rows;
 }
 /**
@@ -633,13 +967,9 @@ void Matrix::insert_row(size_t row, double value) {
  * 
  * @param row index of Matrix to insert row
  */
-void Matrix::insert_row(size_t row) {
-    if(_rows == MAX_MATRIX_SIZE)
-        throw out_of_range("rows at max size");
-    if(row >= _rows)
-        throw out_of_range("Row does not exist");
-    _data.insert(_data.begin() + row, vector<double>(_columns));
-    ++_rows;
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_row(size_t row) {
+    insert_row(row, 0.0);
 }
 
 /**
@@ -648,7 +978,9 @@ void Matrix::insert_row(size_t row) {
  * @param col index of Matrix to insert column
  * @param colNew new column (list)
  */
-void Matrix::insert_column(size_t col, const initializer_list<double>& colNew) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_column(size_t col, 
+        const initializer_list<double>& colNew) {
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
     if(col >= _columns)
@@ -656,11 +988,11 @@ void Matrix::insert_column(size_t col, const initializer_list<double>& colNew) {
     if(_rows != colNew.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    size_t index = 0;
-    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, ++index) {
-        _data[index].insert(_data[index].begin() + col, *iter);
+    insert_column(col);
+    Scalar* dst = _data + col;
+    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
-    ++_columns;
 }
 /**
  * @brief Insert column at index and shift columns on the right
@@ -668,8 +1000,9 @@ void Matrix::insert_column(size_t col, const initializer_list<double>& colNew) {
  * @param col index of Matrix to insert column
  * @param colNew new column (vector<int>)
  */
+template <typename Scalar>
 template <typename T>
-void Matrix::insert_column(size_t col, const vector<T>& colNew) {
+void BasicMatrix<Scalar>::insert_column(size_t col, const vector<T>& colNew) {
     static_assert(is_arithmetic<T>::value, "Vector must be arithmetic");
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
@@ -678,11 +1011,11 @@ void Matrix::insert_column(size_t col, const vector<T>& colNew) {
     if(_rows != colNew.size())
         throw 
             invalid_argument("Column must be same size as Matrix columns");
-    size_t index = 0;
-    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, ++index) {
-        _data[index].insert(_data[index].begin() + col, *iter);
+    insert_column(col);
+    Scalar* dst = _data + col;
+    for(auto iter = colNew.begin(); iter != colNew.end(); ++iter, dst += _ld) {
+        *dst = *iter;
     }
-    ++_columns;
 }
 /**
  * @brief Insert column of values at index and shift columns on the right
@@ -690,14 +1023,17 @@ void Matrix::insert_column(size_t col, const vector<T>& colNew) {
  * @param col index of Matrix to insert column
  * @param value value to fill column
  */
-void Matrix::insert_column(size_t col, double value) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_column(size_t col, Scalar value) {
     if(_columns == MAX_MATRIX_SIZE)
         throw out_of_range("columns at max size");
     if(col >= _columns)
         throw out_of_range("Column does not exist");
-    size_t index = 0;
-    for(auto iter = _data.begin(); iter != _data.end(); ++iter, ++index) {
-        iter->insert(iter->begin() + col, value);
+    _reserve(_rows, _columns + 1);
+    for(size_t i=0; i<_rows; ++i) {
+        Scalar* row = _data + i*_ld;
+        memmove(row + col + 1, row + col, (_columns - col) * sizeof(Scalar));
+        row[col] = value;
     }
     ++_columns;
 }
@@ -706,16 +1042,9 @@ void Matrix::insert_column(size_t col, double value) {
  * 
  * @param col index of Matrix to insert column
  */
-void Matrix::insert_column(size_t col) {
-    if(_columns == MAX_MATRIX_SIZE)
-        throw out_of_range("columns at max size");
-    if(col >= _columns)
-        throw out_of_range("Column does not exist");
-    size_t index = 0;
-    for(auto iter = _data.begin(); iter != _data.end(); ++iter, ++index) {
-        iter->insert(iter->begin() + col, 0);
-    }
-    ++_columns;
+template <typename Scalar>
+void BasicMatrix<Scalar>::insert_column(size_t col) {
+    insert_column(col, 0.0);
 }
 
 
@@ -725,26 +1054,25 @@ void Matrix::insert_column(size_t col) {
  * 
  * 
  */
-void Matrix::swap_row(size_t r1, size_t r2) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::swap_row(size_t r1, size_t r2) {
     if(r1 >= _rows || r2 >= _rows)
         throw out_of_range("Row does not exist");
-    vector<double> tmp = _data[r1];
-    _data[r1] = _data[r2];
-    _data[r2] = tmp;
+    _detach();
+    swap_ranges(_data + r1*_ld, _data + r1*_ld + _columns, _data + r2*_ld);
 }
 /**
  * @brief Swaps 2 columns of given indexes of Matrix
  * 
  * 
  */
-void Matrix::swap_column(size_t c1, size_t c2) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::swap_column(size_t c1, size_t c2) {
     if(c1 >= _columns || c2 >= _columns)
         throw out_of_range("Column does not exist");
-    vector<double> tmp;
+    _detach();
     for(size_t i=0; i<_rows; ++i) {
-        tmp.push_back(_data[i][c1]);
-        _data[i][c1] = _data[i][c2];
-        _data[i][c2] = tmp[i];
+        swap(_data[i*_ld + c1], _data[i*_ld + c2]);
     }
 }
 
@@ -752,13 +1080,13 @@ void Matrix::swap_column(size_t c1, size_t c2) {
  * @brief Deletes last row
  * 
  */
-void Matrix::pop_back_row() {
+template <typename Scalar>
+void BasicMatrix<Scalar>::pop_back_row() {
     if(empty())
         throw domain_error("No values to pop");
     if(_rows == 1) {
         clear();
     } else {
-        _data.pop_back();
         --_rows;
     }
 }
@@ -766,15 +1094,13 @@ void Matrix::pop_back_row() {
  * @brief Deletes last column
  * 
  */
-void Matrix::pop_back_column() {
+template <typename Scalar>
+void BasicMatrix<Scalar>::pop_back_column() {
     if(empty())
         throw domain_error("No values to pop");
     if(_columns == 1) {
         clear();
     } else {
-        for(auto iter = _data.begin(); iter != _data.end(); ++iter) {
-            iter->pop_back();
-        }
         --_columns;
     }
 }
@@ -784,7 +1110,8 @@ void Matrix::pop_back_column() {
  * 
  * @param row index of row in Matrix
  */
-void Matrix::erase_row(size_t row) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::erase_row(size_t row) {
     if(empty())
         throw domain_error("No values to erase");
     if(row >= _rows)
@@ -792,7 +1119,9 @@ void Matrix::erase_row(size_t row) {
     if(_rows == 1) {
         clear();
     } else {
-        _data.erase(_data.begin() + row);
+        _detach();
+        memmove(_data + row*_ld, _data + (row+1)*_ld,
+                (_rows - row - 1) * _ld * sizeof(Scalar));
         --_rows;
     }
 }
@@ -801,7 +1130,8 @@ void Matrix::erase_row(size_t row) {
  * 
  * @param col index of column in Matrix
  */
-void Matrix::erase_column(size_t col) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::erase_column(size_t col) {
     if(empty())
         throw domain_error("No values to erase");
     if(col >= _columns)
@@ -809,8 +1139,11 @@ void Matrix::erase_column(size_t col) {
     if(_columns == 1) {
         clear();
     } else {
-        for(auto iter = _data.begin(); iter != _data.end(); ++iter) {
-            iter->erase(iter->begin() + col);
+        _detach();
+        for(size_t i=0; i<_rows; ++i) {
+            Scalar* row = _data + i*_ld;
+            memmove(row + col, row + col + 1,
+                    (_columns - col - 1) * sizeof(Scalar));
         }
         --_columns;
     }
@@ -820,10 +1153,9 @@ void Matrix::erase_column(size_t col) {
  * @brief clear Matrix
  * 
  */
-void Matrix::clear() {
-    _columns = 0;
-    _rows = 0;
-    _data.clear();
+template <typename Scalar>
+void BasicMatrix<Scalar>::clear() {
+    _release();
 }
 
 /**
@@ -831,7 +1163,8 @@ void Matrix::clear() {
  * 
  * @param other matrix to add
  */
-void Matrix::augment(const Matrix& other, bool seperator) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::augment(const BasicMatrix& other, bool seperator) {
     if(empty()) {
         *this = other;
         return;
@@ -840,184 +1173,384 @@ void Matrix::augment(const Matrix& other, bool seperator) {
         throw invalid_argument("Matricies must have same column length");
     if(seperator)
         _augment_lines.insert(_columns);
-    _columns += other._columns;
+    size_t otherColumns = other._columns; // other may be *this
+    _reserve(_rows, _columns + otherColumns);
     for(size_t i=0; i<_rows; ++i) {
-        for(double x : other._data[i]) {
-            _data[i].push_back(x);
-        }
+        memcpy(_data + i*_ld + _columns, other._data + i*other._ld,
+               otherColumns * sizeof(Scalar));
     }
+    _columns += otherColumns;
 }
 
 /**
- * @brief set Matrix to be the same as other (does not change float lenght)
+ * @brief set Matrix to be the same as other, sharing its storage until either
+ *        one is written to (does not change float lenght)
  * 
+ * An unshareable Matrix copies other into its own storage when it fits, so
+ * views and pointers taken from it stay valid.
  */
-void Matrix::operator=(const Matrix& other) {
-    _columns = other._columns;
-    _rows = other._rows;
-    _data = other._data;
+template <typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator=(const BasicMatrix& other) {
+    if(this == &other)
+        return *this;
     _augment_lines = other._augment_lines;
+    if(_unshareable && !other.empty() 
+       && _capacity >= other._rows && _ld >= other._columns) {
+        for(size_t i=0; i<other._rows; ++i) {
+            memcpy(_data + i*_ld, other._data + i*other._ld,
+                   other._columns * sizeof(Scalar));
+        }
+        _rows = other._rows;
+        _columns = other._columns;
+        return *this;
+    }
+    _release();
+    if(!other.empty())
+        _share(other);
+    return *this;
+}
+/**
+ * @brief take storage of other, leaving it empty (does not change float
+ *        lenght)
+ * 
+ */
+template <typename Scalar>
+BasicMatrix<Scalar>& 
+BasicMatrix<Scalar>::operator=(BasicMatrix&& other) noexcept {
+    if(this == &other)
+        return *this;
+    _release();
+    swap(_data, other._data);
+    swap(_unshareable, other._unshareable);
+    swap(_ld, other._ld);
+    swap(_capacity, other._capacity);
+    swap(_rows, other._rows);
+    swap(_columns, other._columns);
+    _augment_lines = move(other._augment_lines);
+    other._augment_lines.clear();
+    return *this;
 }
-
-
-#pragma endregion // EDIT_FUNCTIONS
-/******************************************************************************/
-#pragma region BINARY_MATH_FUNCTIONS
 
 /**
- * @brief Add Matricies with equal dimentions
+ * @brief replace storage with a fresh buffer of given size (contents are
+ *        zeroed unless zero == false)
  * 
  */
-Matrix Matrix::operator+(const Matrix& other) const {
-    if(empty() || other.empty())
-        throw domain_error("Matricies must have data");
-    if(other._columns != _columns || other._rows != _rows)
-        throw invalid_argument
-            ("Matricies must have same dimentions for addition");
-    Matrix sum;
-    for(size_t i=0; i<_rows; ++i) {
-        vector<double> rowNew;
-        for(size_t j=0; j<_columns; ++j) {
-            rowNew.push_back(_data[i][j] + other._data[i][j]);
+template <typename Scalar>
+void BasicMatrix<Scalar>::_allocate(size_t rows, size_t columns, bool zero) {
+    _release();
+    if(!rows || !columns)
+        return;
+    _ld = _padded_ld(columns, sizeof(Scalar));
+    _data = _alloc_buffer<Scalar>(rows * _ld, zero);
+    _capacity = rows;
+    _rows = rows;
+    _columns = columns;
+}
+/**
+ * @brief grow storage to hold at least rows x columns, keeping contents
+ * 
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::_reserve(size_t rows, size_t columns) {
+    if(rows <= _capacity && columns <= _ld) {
+        _detach(); // rows past _rows may belong to a Matrix sharing storage
+        return;
+    }
+    size_t capacity = _capacity;
+    if(rows > _capacity)
+        capacity = max(rows, _capacity + _capacity / 2);
+    size_t ld = _ld;
+    if(columns > _ld)
+        ld = _padded_ld(max(columns, _ld + _ld / 2), sizeof(Scalar));
+    Scalar* buffer = _alloc_buffer<Scalar>(capacity * ld, true);
+    if(_data) {
+        for(size_t i=0; i<_rows; ++i) {
+            memcpy(buffer + i*ld, _data + i*_ld, _columns * sizeof(Scalar));
         }
-        sum.push_back_row(rowNew);
     }
-    return sum;
+    _free_buffer(_data);
+    _data = buffer;
+    _ld = ld;
+    _capacity = capacity;
 }
 /**
- * @brief Subtract Matricies with equal dimentions
+ * @brief share the storage of other, or copy it when other is unshareable
+ *        (this Matrix must hold none)
  * 
  */
-Matrix Matrix::operator-(const Matrix& other) const {
-    if(empty() || other.empty())
-        throw domain_error("Matricies must have data");
-    if(other._columns != _columns || other._rows != _rows)
-        throw invalid_argument
-            ("Matricies must have same dimentions for subtraction");
-    Matrix sum;
-    for(size_t i=0; i<_rows; ++i) {
-        vector<double> rowNew;
-        for(size_t j=0; j<_columns; ++j) {
-            rowNew.push_back(_data[i][j] - other._data[i][j]);
+template <typename Scalar>
+void BasicMatrix<Scalar>::_share(const BasicMatrix& other) {
+    if(other._unshareable) {
+        _allocate(other._rows, other._columns, false);
+        _rows = other._rows;
+        _columns = other._columns;
+        for(size_t i=0; _data && i<_rows; ++i) {
+            memcpy(_data + i*_ld, other._data + i*other._ld,
+                   _columns * sizeof(Scalar));
         }
-        sum.push_back_row(rowNew);
+        return;
     }
-    return sum;
+    _share_buffer(other._data);
+    _data = other._data;
+    _ld = other._ld;
+    _capacity = other._capacity;
+    _rows = other._rows;
+    _columns = other._columns;
 }
+/**
+ * @brief give this Matrix its own copy of storage it shares with another
+ *        Matrix, before writing to it (copy-on-write)
+ * 
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::_detach() {
+    if(_unshareable || !_shared())
+        return;
+    Scalar* buffer = _alloc_buffer<Scalar>(_capacity * _ld, true);
+    for(size_t i=0; i<_rows; ++i) {
+        memcpy(buffer + i*_ld, _data + i*_ld, _columns * sizeof(Scalar));
+    }
+    _free_buffer(_data);
+    _data = buffer;
+}
+/**
+ * @brief free storage and reset to an empty Matrix
+ * 
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::_release() {
+    _free_buffer(_data);
+    _data = nullptr;
+    _unshareable = false;
+    _ld = 0;
+    _capacity = 0;
+    _rows = 0;
+    _columns = 0;
+}
+
+
+#pragma endregion // EDIT_FUNCTIONS
+/******************************************************************************/
+#pragma region BINARY_MATH_FUNCTIONS
+
 /**
  * @brief Incriment Matrix by another Matrix with equal dimentions
  * 
  */
-Matrix Matrix::operator+=(const Matrix& other) {
-    *this = *this + other;
-    return *this;
+template <typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator+=(const BasicMatrix& other) {
+    return *this += MatrixRef(other);
 }
 /**
  * @brief Deincriment Matrix by another Matrix with equal dimentions
  * 
  */
-Matrix Matrix::operator-=(const Matrix& other) {
-    *this = *this - other;
-    return *this;
+template <typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator-=(const BasicMatrix& other) {
+    return *this -= MatrixRef(other);
 }
 
 /**
  * @brief Multiply Matricices
  * 
  */
-Matrix Matrix::operator*(const Matrix& other) const {
-    if(empty() || other.empty())
+template <typename Scalar>
+BasicMatrix<Scalar> 
+BasicMatrix<Scalar>::operator*(const BasicMatrix& other) const {
+    return _multiply<Scalar>(*this, other);
+}
+/**
+ * @brief Multiply Matricies given as (possibly strided) views
+ * 
+ */
+template <typename S>
+BasicMatrix<S> _multiply(const BasicMatrixView<const S>& lhs,
+                         const BasicMatrixView<const S>& rhs) {
+    if(lhs.empty() || rhs.empty())
         throw domain_error("Matricies must have data");
-    if(_columns != other._rows)
+    if(lhs.columns() != rhs.rows())
         throw invalid_argument
             ("Invalid Matrix dimentions for multiplication");
-    Matrix product;
-    for(size_t i=0; i<_rows; ++i) {
-        vector<double> rowNew;
-        for(size_t j=0; j<other._columns; ++j) {
-            double sum = 0;
-            for(size_t k=0; k<_columns; ++k) {
-                sum += _data[i][k] * other._data[k][j];
-            }
-            rowNew.push_back(sum);
-        }
-        product.push_back_row(rowNew);
-    }
+    MATRIX_OP("multiply", lhs.rows(), rhs.columns(),
+              2.0 * lhs.rows() * rhs.columns() * lhs.columns());
+    BasicMatrix<S> product;
+    product._allocate(lhs.rows(), rhs.columns(), false);
+    _gemm<S>(lhs.rows(), rhs.columns(), lhs.columns(), 1,
+             lhs.data(), lhs.row_stride(), lhs.column_stride(),
+             rhs.data(), rhs.row_stride(), rhs.column_stride(),
+             0, product._data, product._ld);
     return product;
 }
 
 /**
- * @brief multiply Matrix by scale
+ * @brief true when the elements of a and b lie in overlapping memory
  * 
  */
-Matrix Matrix::operator*(double scale) const {
-    if(empty())
-        throw domain_error("Matrix must have data");
-    Matrix product;
-    for(auto rowIter = _data.begin(); rowIter != _data.end(); ++rowIter) {
-        vector<double> rowNew;
-        for(auto iter = rowIter->begin(); iter != rowIter->end(); ++iter) {
-            rowNew.push_back(*iter * scale);
+template <typename S>
+bool _shares_storage(const BasicMatrixView<const S>& a, 
+                     const BasicMatrixView<const S>& b) {
+    if(a.empty() || b.empty())
+        return false;
+    const S* aEnd = &a(a.rows() - 1, a.columns() - 1) + 1;
+    const S* bEnd = &b(b.rows() - 1, b.columns() - 1) + 1;
+    less<const S*> before;
+    return before(a.data(), bEnd) && before(b.data(), aEnd);
+}
+/**
+ * @brief C = alpha * A * B + beta * C, straight into C's storage when _gemm
+ *        can write it (contiguous rows, no overlap with A or B)
+ * 
+ */
+template <typename S>
+void _multiply_add(S alpha, const BasicMatrixView<const S>& A,
+                   const BasicMatrixView<const S>& B, S beta,
+                   const BasicMatrixView<S>& C) {
+    if(A.empty() || B.empty())
+        throw domain_error("Matricies must have data");
+    if(A.columns() != B.rows())
+        throw invalid_argument
+            ("Invalid Matrix dimentions for multiplication");
+    if(C.rows() != A.rows() || C.columns() != B.columns())
+        throw invalid_argument("Result must have dimentions of the product");
+    MATRIX_OP("multiply_add", C.rows(), C.columns(), 0);
+    if(C.column_stride() != 1 || _shares_storage<S>(A, C)
+       || _shares_storage<S>(B, C)) {
+        BasicMatrix<S> product = _multiply(A, B);
+        if(beta == 0)
+            C = product * alpha;
+        else
+            C = product * alpha + C * beta;
+        return;
+    }
+    MATRIX_ADD_FLOPS(2.0 * A.rows() * B.columns() * A.columns());
+    _gemm<S>(A.rows(), B.columns(), A.columns(), alpha,
+             A.data(), A.row_stride(), A.column_stride(),
+             B.data(), B.row_stride(), B.column_stride(),
+             beta, C.data(), C.row_stride());
+}
+
+/**
+ * @brief Matrix = alpha * op(A) * op(B) + beta * Matrix in place, where op()
+ *        transposes when the matching flag is set
+ * 
+ * Runs without allocating unless the Matrix shares storage with A or B. When
+ * beta is zero the Matrix is overwritten (not read) and resized to fit the
+ * product, reusing its buffer when large enough; otherwise its dimentions
+ * must match the product.
+ * 
+ * @param A Matrix or view (e.g. a block, see matrix_view.h)
+ * @param B Matrix or view
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::multiply_add(const BasicMatrixView<const Scalar>& A,
+                                       const BasicMatrixView<const Scalar>& B,
+                                       Scalar alpha, Scalar beta,
+                                       bool transposeA, bool transposeB) {
+    const BasicMatrixView<const Scalar> left = transposeA ? A.transpose() : A;
+    const BasicMatrixView<const Scalar> right = transposeB ? B.transpose() : B;
+    if(beta == 0 && (_rows != left.rows() || _columns != right.columns())) {
+        const BasicMatrixView<const Scalar> current = 
+            static_cast<const BasicMatrix&>(*this).view();
+        if(_shares_storage<Scalar>(current, left)
+           || _shares_storage<Scalar>(current, right)) {
+            *this = _multiply(left, right) * alpha;
+            return;
         }
-        product.push_back_row(rowNew);
+        if(_capacity < left.rows() || _ld < right.columns() || _shared())
+            _allocate(left.rows(), right.columns(), false);
+        _rows = left.rows();
+        _columns = right.columns();
+        _augment_lines.clear();
     }
-    return product;
+    _multiply_add<Scalar>(alpha, left, right, beta, view());
 }
+
 /**
- * @brief multiply Matrix by scale
+ * @brief y = alpha * op(Matrix) * x + beta * y in place, where op()
+ *        transposes when transpose is set
  * 
+ * When beta is zero y is overwritten (not read) and resized to fit.
  */
-Matrix operator*(double scale, const Matrix& rhs) {
-    return rhs * scale;
+template <typename Scalar>
+void BasicMatrix<Scalar>::multiply_vector(const vector<Scalar>& x,
+                                          vector<Scalar>& y, Scalar alpha,
+                                          Scalar beta, bool transpose) const {
+    if(empty())
+        throw domain_error("Matrix must have data");
+    size_t rows = transpose ? _columns : _rows;
+    size_t columns = transpose ? _rows : _columns;
+    if(x.size() != columns)
+        throw invalid_argument("Vector must be same size as number of columns");
+    if(beta == 0)
+        y.resize(rows);
+    else if(y.size() != rows)
+        throw invalid_argument("Result must be same size as number of rows");
+    if(&x == &y) {
+        vector<Scalar> copy(x);
+        multiply_vector(copy.data(), y.data(), alpha, beta, transpose);
+        return;
+    }
+    multiply_vector(x.data(), y.data(), alpha, beta, transpose);
 }
 /**
- * @brief multiply Matrix by scale
+ * @brief y = alpha * op(Matrix) * x + beta * y into a caller supplied
+ *        buffer, where op() transposes when transpose is set (the transpose
+ *        is never formed)
  * 
+ * @param x op(Matrix) columns elements
+ * @param y op(Matrix) rows elements, not overlapping x (not read when beta
+ *          is zero)
  */
-Matrix Matrix::operator*=(double scale) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::multiply_vector(const Scalar* x, Scalar* y,
+                                          Scalar alpha, Scalar beta,
+                                          bool transpose) const {
     if(empty())
         throw domain_error("Matrix must have data");
-    for(auto rowIter = _data.begin(); rowIter != _data.end(); ++rowIter) {
-        for(auto iter = rowIter->begin(); iter != rowIter->end(); ++iter) {
-            *iter *= scale;
-        }
-    }
-    return *this;
+    MATRIX_OP("multiply_vector", _rows, _columns, 2.0 * _rows * _columns);
+    _gemv<Scalar>(transpose, _rows, _columns, alpha, _data, _ld, x, beta, y, 1);
 }
 
 /**
- * @brief divide Matrix by scale
+ * @brief multiply Matrix by scale
  * 
  */
-Matrix Matrix::operator/(double scale) const {
-    if(scale == 0)
-        throw invalid_argument("scale cannot be zero");
+template <typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator*=(Scalar scale) {
     if(empty())
         throw domain_error("Matrix must have data");
-    Matrix quotient;
-    for(auto rowIter = _data.begin(); rowIter != _data.end(); ++rowIter) {
-        vector<double> rowNew;
-        for(auto iter = rowIter->begin(); iter != rowIter->end(); ++iter) {
-            rowNew.push_back(*iter / scale);
+    MATRIX_OP("scale", _rows, _columns, double(_rows) * _columns);
+    _detach();
+    _for_rows(_rows, _columns, [&](size_t lo, size_t hi) {
+        for(size_t i=lo; i<hi; ++i) {
+            Scalar* a = _data + i*_ld;
+            _simd_scale(_columns, scale, a, a);
         }
-        quotient.push_back_row(rowNew);
-    }
-    return quotient;
+    });
+    return *this;
 }
+
 /**
  * @brief divide Matrix by scale
  * 
  */
-Matrix Matrix::operator/=(double scale) {
+template <typename Scalar>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator/=(Scalar scale) {
     if(scale == 0)
         throw invalid_argument("scale cannot be zero");
     if(empty())
         throw domain_error("Matrix must have data");
-    for(auto rowIter = _data.begin(); rowIter != _data.end(); ++rowIter) {
-        for(auto iter = rowIter->begin(); iter != rowIter->end(); ++iter) {
-            *iter /= scale;
+    MATRIX_OP("scale", _rows, _columns, double(_rows) * _columns);
+    _detach();
+    _for_rows(_rows, _columns, [&](size_t lo, size_t hi) {
+        for(size_t i=lo; i<hi; ++i) {
+            Scalar* a = _data + i*_ld;
+            for(size_t j=0; j<_columns; ++j) {
+                a[j] /= scale;
+            }
         }
-    }
+    });
     return *this;
 }
 
@@ -1025,78 +1558,79 @@ Matrix Matrix::operator/=(double scale) {
  * @brief multiply Matrix with vector
  * 
  */
+template <typename Scalar>
 template <typename T>
-Matrix Matrix::operator*(const vector<T>& vec) const {
+BasicMatrix<Scalar> BasicMatrix<Scalar>::operator*(const vector<T>& vec) const {
     if(empty())
         throw domain_error("Matrix must have data");
     if(_columns != vec.size())
         throw invalid_argument("Vector must be same size as number of columns");
-    vector<double> product;
-    for(auto rowIter = _data.begin(); rowIter != _data.end(); ++rowIter) {
-        double sum = 0;
-        size_t index = 0;
-        for(auto iter = vec.begin(); iter != vec.end(); ++iter) {
-            sum += *iter * rowIter->at(index++);
-        }
-        product.push_back(sum);
-    }
-    return Matrix(product);
+    MATRIX_OP("multiply_vector", _rows, _columns, 2.0 * _rows * _columns);
+    const vector<Scalar>& x = _as_scalar<Scalar>(vec);
+    BasicMatrix product;
+    product._allocate(_rows, 1, false);
+    _gemv<Scalar>(false, _rows, _columns, 1, _data, _ld, x.data(), 0,
+                  product._data, product._ld);
+    return product;
 }
 /**
- * @brief multiply Matrix with vector
+ * @brief multiply row vector with Matrix (rhs is read row by row and never
+ *        transposed)
  * 
  */
-template <typename T>
-Matrix operator*(const vector<T>& vector, const Matrix& rhs) {
-    return (rhs.transpose() * vector).transpose();
+template <typename T, typename Scalar>
+BasicMatrix<Scalar> operator*(const vector<T>& vector, 
+                              const BasicMatrix<Scalar>& rhs) {
+    if(rhs.empty())
+        throw invalid_argument("Matrix cannot be empty");
+    size_t rows = rhs.num_rows(), columns = rhs.num_columns();
+    if(rows != vector.size())
+        throw invalid_argument("Vector must be same size as number of rows");
+    const std::vector<Scalar>& x = _as_scalar<Scalar>(vector);
+    BasicMatrix<Scalar> product(1, columns);
+    rhs.multiply_vector(x.data(), product._mutable_data(), 1, 0, true);
+    return product;
 }
 
 /**
  * @brief Takes dot product of vector with itself
  * 
  */
-double Matrix::vec_dot() const {
-    double sum = 0;
-    if(_columns == 1) {
-        for(size_t i=0; i<_rows; ++i) {
-            sum += _data[i][0] * _data[i][0];
-        }
-        return sum;
-    } else if(_rows == 1) {
-        for(size_t i=0; i<_columns; ++i) {
-            sum += _data[0][i] * _data[0][i];
-        }
-        return sum;
-    }
+template <typename Scalar>
+Scalar BasicMatrix<Scalar>::vec_dot() const {
+    MATRIX_OP("vec_dot", _rows, _columns, 2.0 * _rows * _columns);
+    if(_columns == 1)
+        return _simd_dot(_rows, _data, _ld, _data, _ld);
+    else if(_rows == 1)
+        return _simd_dot(_columns, _data, 1, _data, 1);
     throw invalid_argument("Must use vector");
 }
 /**
  * @brief Takes dot product of two vector matricies
  * 
  */
-double Matrix::vec_dot(const Matrix& other) const {
-    vector<double> leftVec, rightVec;
+template <typename Scalar>
+Scalar BasicMatrix<Scalar>::vec_dot(const BasicMatrix& other) const {
+    size_t leftStride, rightStride; // distance between vector elements
     if(_columns == 1) {
-        leftVec = get_column(0);
+        leftStride = _ld;
     } else if(_rows == 1) {
-        leftVec = get_row(0);
+        leftStride = 1;
     } else {
         throw invalid_argument("Must use vectors");
     }
     if(other._columns == 1) {
-        rightVec = other.get_column(0);
+        rightStride = other._ld;
     } else if(other._rows == 1) {
-        rightVec = other.get_row(0);
+        rightStride = 1;
     } else {
         throw invalid_argument("Must use vectors");
     }
-    if(leftVec.size() != rightVec.size())
+    if(size() != other.size())
         throw invalid_argument("Vectors must be same size");
-    double sum = 0;
-    for(size_t i=0; i<leftVec.size(); ++i) {
-        sum += leftVec[i] * rightVec[i];
-    }
-    return sum;
+    MATRIX_OP("vec_dot", _rows, _columns, 2.0 * _rows * _columns);
+    return _simd_dot<Scalar>(size(), _data, leftStride, 
+                             other._data, rightStride);
 }
 
 #pragma endregion // BINARY_MATH_FUNCTIONS
@@ -1107,37 +1641,14 @@ double Matrix::vec_dot(const Matrix& other) const {
  * @brief returns determinate of Matrix
  * 
  */
-double Matrix::determinant() const{
+template <typename Scalar>
+double BasicMatrix<Scalar>::determinant() const{
     if(empty())
         throw invalid_argument("Matrix must have data");
     if(_columns != _rows)
         throw invalid_argument("Matrix must be square");
-    Matrix M(_data);
-    double scale = 1;
-    for(size_t i=0; i<_columns; ++i) {
-        size_t row = i; // starting row == number of past loops
-        while(_is_double_sub_zero(M._data[row][i])) {
-            if(++row == _rows) { // if at end, means at least one 0 on diagonal
-                return 0;
-            }
-        }
-        if(row != i) {
-            M.swap_row(row, i);
-            scale *= -1;
-        }
-        for(row=i+1; row<_rows; ++row) { // sweep rows below
-            if(!_is_double_sub_zero(M._data[row][i])) {
-                double coeff = M._data[row][i] / M._data[i][i];
-                for(size_t j=i; j<_columns; ++j) {
-                    M._data[row][j] -= coeff * M._data[i][j];
-                }
-            }
-        }
-    }
-    for(size_t i=0; i<_rows; ++i) { // multiply diagonal
-        scale *= M._data[i][i];
-    }
-    return scale;
+    MATRIX_OP("determinant", _rows, _columns, double(_rows));
+    return LU(_widen(*this)).determinant();
 }
 
 
@@ -1145,28 +1656,68 @@ double Matrix::determinant() const{
  * @brief returns transpose of Matrix
  * 
  */
-Matrix Matrix::transpose() const {
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::transpose() const {
     if(empty())
         throw invalid_argument("Matrix cannot be empty");
-    Matrix M;
-    for(size_t i = 0; i<_columns; ++i) {
-        M.push_back_row(get_column(i));
-    }
+    MATRIX_OP("transpose", _rows, _columns, 0);
+    BasicMatrix M;
+    M._allocate(_columns, _rows, false);
+    _transpose(_rows, _columns, _data, _ld, M._data, M._ld);
     return M;
 }
+/**
+ * @brief transposes Matrix in place; square Matrices swap elements without
+ *        allocating, others are rebuilt from transpose()
+ * 
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::transpose_in_place() {
+    if(empty())
+        throw invalid_argument("Matrix cannot be empty");
+    MATRIX_OP("transpose_in_place", _rows, _columns, 0);
+    _augment_lines.clear();
+    if(_rows == _columns)
+        _transpose_square(_rows, _mutable_data(), _ld);
+    else
+        *this = transpose();
+}
+/**
+ * @brief lazy transpose: a view of this Matrix with rows and columns swapped
+ *        (nothing is moved; products read it in place, see matrix_view.h)
+ * 
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrix<Scalar>::transpose_view() {
+    return view().transpose();
+}
+/**
+ * @brief read only lazy transpose (see transpose_view())
+ * 
+ */
+template <typename Scalar>
+BasicMatrixView<const Scalar> BasicMatrix<Scalar>::transpose_view() const {
+    return view().transpose();
+}
 
 /**
  * @brief Computes reduced row echelon form of Matrix with Gaussian elimination
  *  
  */
-Matrix Matrix::rref() const {
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::rref() const {
     if(empty())
         throw invalid_argument("Matrix cannot be empty");
-    Matrix M = *this;
+    MATRIX_OP("rref", _rows, _columns, 0);
+    BasicMatrix M = *this;
+    M._detach(); // written through M._data below
+    const size_t ld = M._ld;
+    vector<Scalar> leadingVals(_rows); // leading values at col: lead
     size_t lead = 0; // column of current leading value
     for(size_t i=0; i<_rows && lead<_columns; ++i) {
+        MATRIX_TRACE_SPAN("rref pivot", _rows, _columns - lead, (long)i);
         size_t row = i; // current row (start at top of unchanged lead values)
-        while(_is_double_sub_zero(M._data[row][lead])) { // while zero
+        while(_is_double_sub_zero(M._data[row*ld + lead])) { // while zero
             ++row;
             if(row == _rows) {
                 row = i;
@@ -1176,150 +1727,277 @@ Matrix Matrix::rref() const {
                 }
             }
         }
-        swap(M._data[row], M._data[i]);
-        double *leadingVals = new double[_rows]; // leading values at col: lead
+        if(row != i)
+            M.swap_row(row, i);
         for(size_t k=0; k<_rows; ++k) {
-            leadingVals[k] = M._data[k][lead];
+            leadingVals[k] = M._data[k*ld + lead];
         }
+        Scalar* pivotRow = M._data + i*ld;
         for(size_t j=lead; j<_columns; ++j) {
-            M._data[i][j] /= leadingVals[i];
-            double tmp = M._data[i][j];
-            for(size_t k=0; k<_rows; ++k) {
-                if(k != i && !_is_double_sub_zero(leadingVals[k])) {
-                    M._data[k][j] -= leadingVals[k] * tmp;
-                }
+            pivotRow[j] /= leadingVals[i];
+        }
+        MATRIX_ADD_FLOPS(double(_columns - lead));
+        for(size_t k=0; k<_rows; ++k) { // sweep every other row
+            if(k != i && !_is_double_sub_zero(leadingVals[k])) {
+                MATRIX_ADD_FLOPS(2.0 * (_columns - lead));
+                Scalar* sweepRow = M._data + k*ld;
+                _simd_axpy(_columns - lead, -leadingVals[k], pivotRow + lead,
+                           sweepRow + lead, sweepRow + lead);
             }
         }
-        delete[] leadingVals;
         ++lead;
     }
     return M;
 }
 
 /**
- * @brief returns inverse of Matrix
+ * @brief returns inverse of Matrix (by Cholesky when symmetric positive
+ *        definite, else LU)
  * 
  */
-Matrix Matrix::inverse() const {
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::inverse() const {
     if(empty())
         throw invalid_argument("Matrix must have data");
     if(_columns != _rows)
         throw invalid_argument("Matrix must be square");
-    if(_is_double_sub_zero(determinant())) {
+    MATRIX_OP("inverse", _rows, _columns, 0);
+    const Matrix& A = _widen(*this);
+    if(_maybe_spd(A)) {
+        Cholesky spd(A);
+        if(spd.spd()) {
+            MATRIX_COUNT("inverse.cholesky", 1);
+            return _narrow<Scalar>(spd.inverse());
+        }
+        MATRIX_COUNT("inverse.cholesky_failed", 1);
+    }
+    MATRIX_COUNT("inverse.lu", 1);
+    LU factors(A);
+    if(factors.singular()) {
+        MATRIX_COUNT("inverse.singular", 1);
         cerr << "Matrix not invertable";
-        return Matrix();
+        return BasicMatrix();
     }
-    Matrix M(_data);
-    size_t len = _rows;
-    for(size_t i=0; i<len; ++i) {
-        vector<double> idCol(len);
-        idCol[i] = 1;
-        M.push_back_column(idCol);
+    return _narrow<Scalar>(factors.inverse());
+}
+
+/**
+ * @brief LU factorization of Matrix with partial pivoting, for reusing one
+ *        elimination across determinant(), inverse() and solve() calls
+ * 
+ */
+template <typename Scalar>
+LU BasicMatrix<Scalar>::lu() const {
+    return LU(_widen(*this));
+}
+
+/**
+ * @brief Solves this * X = B for X by Cholesky factorization if symmetric
+ *        positive definite, else LU (no inverse is formed); factor once with
+ *        cholesky() or lu() to solve repeatedly
+ * 
+ * @param B right hand sides, one per column
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::solve(const BasicMatrix& B) const {
+    MATRIX_OP("solve", _rows, _columns, 0);
+    const Matrix& A = _widen(*this);
+    if(_maybe_spd(A)) {
+        Cholesky spd(A);
+        if(spd.spd())
+            return _narrow<Scalar>(spd.solve(_widen(B)));
     }
-    Matrix I = M.rref();
-    for(size_t i=0; i<len; ++i) {
-        I.erase_column(0);
+    return _narrow<Scalar>(LU(A).solve(_widen(B)));
+}
+/**
+ * @brief Solves this * x = b for x by Cholesky factorization if symmetric
+ *        positive definite, else LU (no inverse is formed); factor once with
+ *        cholesky() or lu() to solve repeatedly
+ * 
+ * @param b right hand side
+ */
+template <typename Scalar>
+vector<Scalar> BasicMatrix<Scalar>::solve(const vector<Scalar>& b) const {
+    MATRIX_OP("solve", _rows, _columns, 0);
+    const Matrix& A = _widen(*this);
+    if(_maybe_spd(A)) {
+        Cholesky spd(A);
+        if(spd.spd())
+            return _narrow<Scalar>(spd.solve(_widen(b)));
     }
-    return I;
+    return _narrow<Scalar>(LU(A).solve(_widen(b)));
+}
+
+/**
+ * @brief Cholesky factorization of a symmetric positive definite Matrix
+ *        (check spd() on the result)
+ * 
+ */
+template <typename Scalar>
+Cholesky BasicMatrix<Scalar>::cholesky() const {
+    return Cholesky(_widen(*this));
 }
 
 /**
- * @brief Finds QR decompisition of Matrix
+ * @brief Finds QR decompisition of Matrix with Householder reflections (use
+ *        HouseholderQR directly to apply Q without forming it)
  * 
  * @return pair<Matrix,Matrix>; first = Q, second = R 
  */
-Matrix::MatrixPair Matrix::qr() const {
+template <typename Scalar>
+typename BasicMatrix<Scalar>::MatrixPair BasicMatrix<Scalar>::qr() const {
     if(empty())
         throw invalid_argument("Matrix must have data");
-    Matrix Q_matrix, R_matrix(_columns, _columns);
-    for(size_t i=0; i<_columns; ++i) {
-        Matrix col = get_column(i);
-        Matrix colPerp = col;
-        for(size_t j=0; j<i; ++j) {
-            Matrix qCol = Q_matrix.get_column(j);
-            float dot = col.vec_dot(qCol);
-            R_matrix.at(j, i) = dot;
-            colPerp -= qCol * dot;
-        }
-        float colPerpLen = sqrt(colPerp.vec_dot());
-        if(colPerpLen == 0) {
-            throw invalid_argument("Columns must be linearly independant");
-        }
-        R_matrix.at(i, i) = colPerpLen;
-        Q_matrix.augment(colPerp/colPerpLen, false);
-    }
-    return MatrixPair(Q_matrix,R_matrix);
+    MATRIX_OP("qr", _rows, _columns, 0);
+    HouseholderQR factors(_widen(*this));
+    if(!factors.full_rank())
+        throw invalid_argument("Columns must be linearly independant");
+    return MatrixPair(_narrow<Scalar>(factors.Q()), 
+                      _narrow<Scalar>(factors.R()));
 }
 /**
  * @brief Returns Q or R from QR decompisition
  * 
  * @param output Which matrix to output (Matrix::Q or Matrix::R)
  */
-Matrix Matrix::qr(QR output) const {
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::qr(QR output) const {
     if(empty())
         throw invalid_argument("Matrix must have data");
-    if(output == Q) {
-        Matrix Q_matrix;
-        for(size_t i=0; i<_columns; ++i) {
-            Matrix col = get_column(i);
-            Matrix colPerp = col;
-            for(size_t j=0; j<i; ++j) {
-                Matrix qCol = Q_matrix.get_column(j);
-                colPerp -= qCol * col.vec_dot(qCol);
-            }
-            float colPerpLen = sqrt(colPerp.vec_dot());
-            if(colPerpLen == 0) {
-                throw invalid_argument("Columns must be linearly independant");
-            }
-            Q_matrix.augment(colPerp/colPerpLen, false);
-        }
-        return Q_matrix;
-    }
-    if(output == R) {
-        return qr().second;
-    }
-    throw invalid_argument("Invalid param must be Matrix::Q or Matrix::R");
+    if(output != Q && output != R)
+        throw invalid_argument("Invalid param must be Matrix::Q or Matrix::R");
+    MATRIX_OP("qr", _rows, _columns, 0);
+    HouseholderQR factors(_widen(*this));
+    if(!factors.full_rank())
+        throw invalid_argument("Columns must be linearly independant");
+    return _narrow<Scalar>(output == Q ? factors.Q() : factors.R());
 }
 
 /**
  * @brief Finds eigenvalues of Matrix if all real as vector<double>
  * 
- * @param percision defines upper matrix with values below diagnol < percision
- *                  (defaults to 10^-12)
- * @param max_iterations max number of iterations of QR algorithm
+ * @param percision size of a subdiagonal element, relative to its diagonal
+ *                  neighbours, treated as 0 (defaults to 10^-12)
+ * @param max_iterations max number of QR sweeps
  */
+template <typename Scalar>
 vector<double> 
-Matrix::eigenvalues_approx(double percision, int max_iterations) const {
+BasicMatrix<Scalar>::eigenvalues_approx(double percision, 
+                                        int max_iterations) const {
+    MATRIX_OP("eigenvalues_approx", _rows, _columns, 0);
+    vector<complex<double>> values = eigenvalues(percision, max_iterations);
+    vector<double> output;
+    for(const complex<double>& value : values) {
+        if(value.imag() != 0)
+            throw runtime_error("Eigenvalues are complex, use eigenvalues()");
+        output.push_back(value.real());
+    }
+    return output;
+}
+/**
+ * @brief Finds all eigenvalues of Matrix, largest magnitude first (complex
+ *        conjugate pairs are adjacent, positive imaginary part first)
+ * 
+ * Reduces a copy to Hessenberg form, then runs Francis double shift QR with
+ * deflation.
+ * 
+ * @param percision size of a subdiagonal element, relative to its diagonal
+ *                  neighbours, treated as 0 (defaults to 10^-12)
+ * @param max_iterations max number of QR sweeps
+ */
+template <typename Scalar>
+vector<complex<double>> 
+BasicMatrix<Scalar>::eigenvalues(double percision, int max_iterations) const {
     if(empty())
         throw invalid_argument("Matrix must have data");
     if(_columns != _rows)
         throw invalid_argument("Matrix must be square");
-    bool is_upper = false;
-    Matrix tmp = _data;
-    int count;
-    for(count=0; !is_upper && count<max_iterations; ++count) {
-        MatrixPair QR = tmp.qr();
-        tmp = QR.second * QR.first;
-        is_upper = true;
-        for(size_t row=0; row<_rows && is_upper; row++) {
-            for(size_t col=0; col<row && is_upper; col++) {
-                if(abs(tmp._data[row][col]) > percision) {
-                    is_upper = false;
-                }
-            }
-        }
-    }
-    if(!is_upper)
-        throw runtime_error("Could not find values, could be imaginary");
-    vector<double> output;
-    for(size_t i=0; i<_rows; ++i) {
-        output.push_back(tmp._data[i][i]);
-    }
+    MATRIX_OP("eigenvalues", _rows, _columns, 10.0 / 3.0 * _rows * _rows * _rows);
+    Matrix H = _widen(*this);
+    _hessenberg(_rows, H._mutable_data(), H.leading_dim());
+    vector<complex<double>> output;
+    if(!_hessenberg_eigenvalues(_rows, H._mutable_data(), H.leading_dim(),
+                                percision, max(max_iterations, 0), output))
+        throw runtime_error("Could not find values");
+    stable_sort(output.begin(), output.end(), 
+        [](const complex<double>& a, const complex<double>& b) {
+            if(abs(a) != abs(b))
+                return abs(a) > abs(b);
+            if(a.real() != b.real())
+                return a.real() > b.real();
+            return a.imag() > b.imag();
+        });
     return output;
 }
 
 #pragma endregion // UNIARY_MATH_FUNCTIONS
 /******************************************************************************/
+#pragma region BINARY_FILES
+
+/**
+ * @brief write Matrix to path in the binary Matrix file format (see
+ *        serialize.h), replacing the file
+ * 
+ */
+template <typename Scalar>
+void BasicMatrix<Scalar>::save(const string& path) const {
+    MATRIX_OP("save", _rows, _columns, 0);
+    ofstream file(path, ios::binary | ios::trunc);
+    if(!file)
+        throw runtime_error("Cannot open " + path);
+    const size_t rows = _data ? _rows : 0, columns = _data ? _columns : 0;
+    const _MatrixFileHeader header = _file_header(_file_type<Scalar>(), rows,
+                                                  columns);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(_ld == columns) {
+        file.write(reinterpret_cast<const char*>(_data),
+                   rows * columns * sizeof(Scalar));
+    } else {
+        for(size_t i=0; i<rows; ++i)
+            file.write(reinterpret_cast<const char*>(_data + i*_ld),
+                       columns * sizeof(Scalar));
+    }
+    file.close();
+    if(!file)
+        throw runtime_error("Cannot write " + path);
+}
+
+/**
+ * @brief read a Matrix saved with save(), converting element type and byte
+ *        order if they differ (see BasicMappedMatrix to read in place)
+ * 
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> BasicMatrix<Scalar>::load(const string& path) {
+    ifstream file(path, ios::binary | ios::ate);
+    if(!file)
+        throw runtime_error("Cannot open " + path);
+    const uint64_t fileSize = file.tellg();
+    _MatrixFileHeader header;
+    file.seekg(0);
+    if(fileSize < sizeof(header)
+       || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        throw runtime_error("Not a Matrix file: " + path);
+    const bool swapped = _check_file_header(header, fileSize);
+    BasicMatrix result;
+    if(!header.rows || !header.columns)
+        return result;
+    if(header.rows > MAX_MATRIX_SIZE || header.columns > MAX_MATRIX_SIZE)
+        throw out_of_range("size must be less than MAX_MATRIX_SIZE");
+    MATRIX_OP("load", header.rows, header.columns, 0);
+    result._allocate(header.rows, header.columns, false);
+    file.seekg(header.data_offset);
+    if(header.type == _FILE_FLOAT64)
+        _read_elements<double>(file, header, swapped, result._data,
+                               result._ld);
+    else
+        _read_elements<float>(file, header, swapped, result._data,
+                              result._ld);
+    return result;
+}
+
+#pragma endregion // BINARY_FILES
+/******************************************************************************/
 #pragma region OUTPUT
 
 /**
@@ -1328,14 +2006,16 @@ Matrix::eigenvalues_approx(double percision, int max_iterations) const {
  * @param os output stream
  * @param mat Matrix object 
  */
-ostream& operator<<(ostream &os, const Matrix& mat) {
+template <typename Scalar>
+ostream& operator<<(ostream &os, const BasicMatrix<Scalar>& mat) {
     /* Find max integer lenghts of each column */
     int *intMaxLen = new int[mat._columns]; // set to 1s
     for(size_t i=0; i<mat._columns; ++i) {
         intMaxLen[i] = 0;
     }
     bool allInt = true;
-    for(vector<double> row : mat._data) {
+    for(size_t r=0; r<mat._rows; ++r) {
+        const Scalar* row = mat._data + r*mat._ld;
         for(size_t i=0; i<mat._columns; ++i) {
             double intPart, floatPart = modf(row[i], &intPart);
             int intLen = to_string((int)(intPart+0.5-(row[i]<0))).length();
@@ -1368,11 +2048,11 @@ ostream& operator<<(ostream &os, const Matrix& mat) {
                 os << "|";
             os << " " 
                << setw(intMaxLen[col] + float_length + (float_length != 0)); 
-            if(_is_double_sub_zero(mat._data[row][col]))
+            if(_is_double_sub_zero(mat(row, col)))
                 os << setprecision(0) << 0 
                    << setprecision(float_length) << " ";
             else
-                os << mat._data[row][col] << " ";
+                os << mat(row, col) << " ";
             // if(col != mat._columns-1)
             //     os << "  ";
         }
@@ -1391,7 +2071,8 @@ ostream& operator<<(ostream &os, const Matrix& mat) {
  * @brief (BROKEN) set float lenth of values when printing
  * 
  */
-void Matrix::output_floatLen(unsigned int len) {
+template <typename Scalar>
+void BasicMatrix<Scalar>::output_floatLen(unsigned int len) {
     if(len > MAX_FLOAT_LEN)
         throw invalid_argument
             ("float length must be less than MAX_FLOAT_LEN");
@@ -1404,42 +2085,52 @@ void Matrix::output_floatLen(unsigned int len) {
 /******************************************************************************/
 #pragma region EXPLICIT_INSTANTIATIONS
 
+/* element types */
+template class BasicMatrix<double>;
+template class BasicMatrix<float>;
+template BasicMatrix<double>::BasicMatrix(const BasicMatrix<float>& other);
+template BasicMatrix<float>::BasicMatrix(const BasicMatrix<double>& other);
+template ostream& operator<<(ostream &os, const BasicMatrix<double>& mat);
+template ostream& operator<<(ostream &os, const BasicMatrix<float>& mat);
+template BasicMatrix<double> _multiply(const ConstMatrixView& lhs,
+                                       const ConstMatrixView& rhs);
+template BasicMatrix<float> _multiply(const ConstMatrixFView& lhs,
+                                      const ConstMatrixFView& rhs);
+template void _multiply_add(double alpha, const ConstMatrixView& A,
+                            const ConstMatrixView& B, double beta,
+                            const MatrixView& C);
+template void _multiply_add(float alpha, const ConstMatrixFView& A,
+                            const ConstMatrixFView& B, float beta,
+                            const MatrixFView& C);
+
+/* members taking a vector<T>, for element type S */
+#define INSTANTIATE_VECTOR_MEMBERS(S, T) \
+template BasicMatrix<S>::BasicMatrix(const vector<vector<T>>& in); \
+template BasicMatrix<S>::BasicMatrix(const vector<T>& in, orientation type); \
+template void BasicMatrix<S>::push_back_row(const vector<T>& row); \
+template void BasicMatrix<S>::push_back_column(const vector<T>& col); \
+template void BasicMatrix<S>::set_row(size_t row, const vector<T>& rowNew); \
+template void BasicMatrix<S>::set_column(size_t col, const vector<T>& colNew); \
+template void BasicMatrix<S>::insert_row(size_t row, const vector<T>& rowNew); \
+template void BasicMatrix<S>::insert_column(size_t col, \
+                                            const vector<T>& colNew); \
+template BasicMatrix<S> \
+BasicMatrix<S>::operator*(const vector<T>& vector) const; \
+template BasicMatrix<S> \
+operator*(const vector<T>& vector, const BasicMatrix<S>& rhs);
+
 /* int */
-template Matrix::Matrix(const vector<vector<int>>& in);
-template Matrix::Matrix(const vector<int>& in, orientation type);
-template void Matrix::push_back_row(const vector<int>& row);
-template void Matrix::push_back_column(const vector<int>& col);
-template void Matrix::set_row(size_t row, const vector<int>& rowNew);
-template void Matrix::set_column(size_t col, const vector<int>& colNew);
-template void Matrix::insert_row(size_t row, const vector<int>& rowNew);
-template void Matrix::insert_column(size_t col, const vector<int>& colNew);
-template Matrix Matrix::operator*(const vector<int>& vector) const;
-template Matrix operator*(const vector<int>& vector, const Matrix& rhs);
+INSTANTIATE_VECTOR_MEMBERS(double, int)
+INSTANTIATE_VECTOR_MEMBERS(float, int)
 
 
 /* double */
-template Matrix::Matrix(const vector<vector<double>>& in);
-template Matrix::Matrix(const vector<double>& in, orientation type);
-template void Matrix::push_back_row(const vector<double>& row);
-template void Matrix::push_back_column(const vector<double>& col);
-template void Matrix::set_row(size_t row, const vector<double>& rowNew);
-template void Matrix::set_column(size_t col, const vector<double>& colNew);
-template void Matrix::insert_row(size_t row, const vector<double>& rowNew);
-template void Matrix::insert_column(size_t col, const vector<double>& colNew);
-template Matrix Matrix::operator*(const vector<double>& vector) const;
-template Matrix operator*(const vector<double>& vector, const Matrix& rhs);
+INSTANTIATE_VECTOR_MEMBERS(double, double)
+INSTANTIATE_VECTOR_MEMBERS(float, double)
 
 
 /* float */
-template Matrix::Matrix(const vector<vector<float>>& in);
-template Matrix::Matrix(const vector<float>& in, orientation type);
-template void Matrix::push_back_row(const vector<float>& row);
-template void Matrix::push_back_column(const vector<float>& col);
-template void Matrix::set_row(size_t row, const vector<float>& rowNew);
-template void Matrix::set_column(size_t col, const vector<float>& colNew);
-template void Matrix::insert_row(size_t row, const vector<float>& rowNew);
-template void Matrix::insert_column(size_t col, const vector<float>& colNew);
-template Matrix Matrix::operator*(const vector<float>& vector) const;
-template Matrix operator*(const vector<float>& vector, const Matrix& rhs);
+INSTANTIATE_VECTOR_MEMBERS(double, float)
+INSTANTIATE_VECTOR_MEMBERS(float, float)
 
 #pragma endregion // EXPLICIT_INSTANTIATIONS
@@ -3,14 +3,64 @@
 #define MATRIX_H
 
 #include <iostream>
+#include <complex>
+#include <string>
 #include <vector>
 #include <set>
+#include <atomic>
+#include "instrument.h"
 // #include <initializer_list>  /* included in <vector> */
 
+#define MATRIX_ALIGNMENT 64 // byte alignment of Matrix storage (cache line)
+#define MAX_MATRIX_SIZE 0x20000000 // 2^29, max rows or columns
+
 extern bool NICE_BRACKET;
 
+/**
+ * @brief reference count of Matrix storage, kept in the MATRIX_ALIGNMENT
+ *        bytes allocated in front of data
+ * 
+ */
+inline std::atomic<std::size_t>& _buffer_refs(const void* data) {
+    return *reinterpret_cast<std::atomic<std::size_t>*>(
+        const_cast<char*>(static_cast<const char*>(data)) - MATRIX_ALIGNMENT);
+}
+
+template <typename E> class MatrixExpr;
+template <typename Scalar> class BasicMatrix;
+template <typename Scalar> class BasicMatrixView;
+class LU;
+class Cholesky;
+
+typedef BasicMatrix<double> Matrix; // double precision
+typedef BasicMatrix<float> MatrixF; // single precision
 
-class Matrix {
+template <typename Scalar>
+std::ostream& operator<<(std::ostream &os, const BasicMatrix<Scalar>& mat);
+
+/**
+ * @brief Matrix storing (and computing in) elements of type Scalar
+ * 
+ * Instantiated for double (Matrix) and float (MatrixF). Storage, element
+ * access, arithmetic, products and elimination run in Scalar, so float halves
+ * memory traffic and doubles the elements per SIMD register. Factorizations
+ * (LU, Cholesky, QR, eigenvalues) are double only; on MatrixF they widen a
+ * copy to double and narrow the result back.
+ * 
+ * Copies share storage (reference counted, safe to copy from several threads)
+ * until one of them is written to, which first gives it a private copy. The
+ * first mutable element access (non-const operator(), at(), data() or a
+ * mutable view) also takes a private copy and marks the storage unshareable:
+ * later copies of that Matrix copy its elements, so references, pointers and
+ * views handed out stay valid and never write into a copy, and mutable access
+ * costs no more than a plain load afterwards. That first access writes the
+ * Matrix, so make it before sharing the Matrix between threads; after it, any
+ * number of threads may read through the mutable accessors. Results computed
+ * by the library (products, inverse(), solve(), factors) are written without
+ * marking them, so copying a result stays O(1).
+ */
+template <typename Scalar>
+class BasicMatrix {
 public:
 
     enum orientation {
@@ -23,69 +73,100 @@ public:
         R
     };
 
-    typedef std::pair<Matrix,Matrix> MatrixPair;
+    typedef std::pair<BasicMatrix,BasicMatrix> MatrixPair;
+    typedef Scalar value_type;
 
     /* Constructors */
 
-    Matrix();
-    Matrix(std::initializer_list<std::initializer_list<double>> in);
-    Matrix(std::initializer_list<double> in, orientation type=column);
+    BasicMatrix();
+    BasicMatrix(std::initializer_list<std::initializer_list<double>> in);
+    BasicMatrix(std::initializer_list<double> in, orientation type=column);
     template <typename T> 
-    Matrix(const std::vector<std::vector<T>>& in);
+    BasicMatrix(const std::vector<std::vector<T>>& in);
     template <typename T> 
-    Matrix(const std::vector<T>& in, orientation type=column);
-    Matrix(const Matrix& other);
-    Matrix(std::size_t rows, std::size_t columns, double value);
-    Matrix(std::size_t rows, std::size_t columns);
-    Matrix(std::size_t identitySize);
+    BasicMatrix(const std::vector<T>& in, orientation type=column);
+    BasicMatrix(const BasicMatrix& other);
+    BasicMatrix(BasicMatrix&& other) noexcept;
+    template <typename U>
+    explicit BasicMatrix(const BasicMatrix<U>& other);
+    BasicMatrix(std::size_t rows, std::size_t columns, Scalar value);
+    BasicMatrix(std::size_t rows, std::size_t columns);
+    BasicMatrix(std::size_t identitySize);
+    template <typename E>
+    BasicMatrix(const MatrixExpr<E>& expr);
+    ~BasicMatrix();
     
     /* Get functions */
 
     int num_rows() const;
     int num_columns() const;
-    std::vector<double> get_row(std::size_t row) const;
-    std::vector<double> get_column(std::size_t col) const;
-    std::vector<double> to_vector() const;
-    double& at(std::size_t row, std::size_t col);
+    std::vector<Scalar> get_row(std::size_t row) const;
+    std::vector<Scalar> get_column(std::size_t col) const;
+    std::vector<Scalar> to_vector() const;
+    Scalar& at(std::size_t row, std::size_t col);
     int size() const;
     bool empty() const;
 
+    /* Raw storage access (row-major, rows are leading_dim() apart) */
+
+    Scalar* data();
+    const Scalar* data() const;
+    std::size_t leading_dim() const;
+    Scalar& operator()(std::size_t row, std::size_t col);
+    const Scalar& operator()(std::size_t row, std::size_t col) const;
+
+    /* Views (no copy, write through to this Matrix, see matrix_view.h) */
+
+    BasicMatrixView<Scalar> view();
+    BasicMatrixView<const Scalar> view() const;
+    BasicMatrixView<Scalar> row_view(std::size_t row);
+    BasicMatrixView<const Scalar> row_view(std::size_t row) const;
+    BasicMatrixView<Scalar> column_view(std::size_t col);
+    BasicMatrixView<const Scalar> column_view(std::size_t col) const;
+    BasicMatrixView<Scalar> block(std::size_t row, std::size_t col,
+                                  std::size_t rows, std::size_t columns,
+                                  std::size_t rowStep=1, std::size_t colStep=1);
+    BasicMatrixView<const Scalar> block(std::size_t row, std::size_t col,
+                                        std::size_t rows, std::size_t columns,
+                                        std::size_t rowStep=1,
+                                        std::size_t colStep=1) const;
+
     /* Edit functions */
 
     template <typename T> 
     void push_back_row(const std::vector<T>& row);
     void push_back_row(const std::initializer_list<double>& row);
-    void push_back_row(double value);
+    void push_back_row(Scalar value);
     void push_back_row();
 
     template <typename T> 
     void push_back_column(const std::vector<T>& col);
     void push_back_column(const std::initializer_list<double>& col);
-    void push_back_column(double value);
+    void push_back_column(Scalar value);
     void push_back_column();
 
     template <typename T>
     void set_row(std::size_t row, const std::vector<T>& rowNew);
     void set_row(std::size_t row, const std::initializer_list<double>& rowNew);
-    void set_row(std::size_t row, double value);
+    void set_row(std::size_t row, Scalar value);
     void set_row(std::size_t row);
 
     template <typename T>
     void set_column(std::size_t col, const std::vector<T>& colNew);
     void set_column(std::size_t col, const std::initializer_list<double>& colNew);
-    void set_column(std::size_t col, double value);
+    void set_column(std::size_t col, Scalar value);
     void set_column(std::size_t col);
 
     template <typename T>
     void insert_row(std::size_t row, const std::vector<T>& rowNew);
     void insert_row(std::size_t row, const std::initializer_list<double>& rowNew);
-    void insert_row(std::size_t row, double value);
+    void insert_row(std::size_t row, Scalar value);
     void insert_row(std::size_t row);
 
     template <typename T>
     void insert_column(std::size_t col, const std::vector<T>& colNew);
     void insert_column(std::size_t col, const std::initializer_list<double>& colNew);
-    void insert_column(std::size_t col, double value);
+    void insert_column(std::size_t col, Scalar value);
     void insert_column(std::size_t col);
 
     void swap_row(std::size_t r1, std::size_t r2);
@@ -96,56 +177,164 @@ public:
     void erase_column(std::size_t col);
     void clear();
 
-    void augment(const Matrix& other, bool seperator=true);
-    void operator=(const Matrix& other);
+    void augment(const BasicMatrix& other, bool seperator=true);
+    BasicMatrix& operator=(const BasicMatrix& other);
+    BasicMatrix& operator=(BasicMatrix&& other) noexcept;
+    template <typename E>
+    BasicMatrix& operator=(const MatrixExpr<E>& expr);
 
-    /* Binary math functions */
+    /* Binary math functions (+, - and scaling are lazy, see matrix_expr.h) */
 
-    Matrix operator+(const Matrix& other) const;
-    Matrix operator-(const Matrix& other) const;
-    Matrix operator+=(const Matrix& other);
-    Matrix operator-=(const Matrix& other);
+    BasicMatrix& operator+=(const BasicMatrix& other);
+    BasicMatrix& operator-=(const BasicMatrix& other);
+    template <typename E>
+    BasicMatrix& operator+=(const MatrixExpr<E>& expr);
+    template <typename E>
+    BasicMatrix& operator-=(const MatrixExpr<E>& expr);
 
-    Matrix operator*(const Matrix& other) const;
+    BasicMatrix operator*(const BasicMatrix& other) const;
+    void multiply_add(const BasicMatrixView<const Scalar>& A,
+                      const BasicMatrixView<const Scalar>& B,
+                      Scalar alpha=1, Scalar beta=1,
+                      bool transposeA=false, bool transposeB=false);
+    void multiply_vector(const std::vector<Scalar>& x, std::vector<Scalar>& y,
+                         Scalar alpha=1, Scalar beta=0,
+                         bool transpose=false) const;
+    void multiply_vector(const Scalar* x, Scalar* y, Scalar alpha=1,
+                         Scalar beta=0, bool transpose=false) const;
 
-    Matrix operator*(double scale) const;
-    friend Matrix operator*(double scale, const Matrix& rhs);
-    Matrix operator*=(double scale);
-    Matrix operator/(double scale) const;
-    Matrix operator/=(double scale);
+    BasicMatrix& operator*=(Scalar scale);
+    BasicMatrix& operator/=(Scalar scale);
 
     template <typename T> 
-    Matrix operator*(const std::vector<T>& vector) const;
-    template <typename T> friend 
-    Matrix operator*(const std::vector<T>& vector, const Matrix& rhs);
+    BasicMatrix operator*(const std::vector<T>& vector) const;
     
-    double vec_dot() const;
-    double vec_dot(const Matrix& other) const;
+    Scalar vec_dot() const;
+    Scalar vec_dot(const BasicMatrix& other) const;
 
     /* Uniary math functions */
 
     double determinant() const;
-    Matrix transpose() const;
-    Matrix rref() const;
-    Matrix inverse() const;
+    BasicMatrix transpose() const;
+    void transpose_in_place();
+    BasicMatrixView<Scalar> transpose_view();
+    BasicMatrixView<const Scalar> transpose_view() const;
+    BasicMatrix rref() const;
+    BasicMatrix inverse() const;
+    LU lu() const;
+    Cholesky cholesky() const;
+    BasicMatrix solve(const BasicMatrix& B) const;
+    std::vector<Scalar> solve(const std::vector<Scalar>& b) const;
     MatrixPair qr() const;
-    Matrix qr(QR output) const;
+    BasicMatrix qr(QR output) const;
     std::vector<double> eigenvalues_approx(double percision=1e-12, 
                                            int max_iterations=100000) const;
+    std::vector<std::complex<double>> eigenvalues(double percision=1e-12, 
+                                           int max_iterations=100000) const;
+
+    /* Binary files (see serialize.h) */
+
+    void save(const std::string& path) const;
+    static BasicMatrix load(const std::string& path);
+
+    /* Text files (comma, tab or whitespace separated, see csv.cpp) */
+
+    static BasicMatrix read_csv(std::istream& in, char delimiter=',',
+                                bool header=false);
+    static BasicMatrix read_csv(const std::string& path, char delimiter=',',
+                                bool header=false);
+    void write_csv(std::ostream& out, char delimiter=',') const;
+    void write_csv(const std::string& path, char delimiter=',') const;
 
     /* Output */
 
-    friend std::ostream& operator<<(std::ostream &os, const Matrix& mat);
+    friend std::ostream& operator<< <>(std::ostream &os, 
+                                       const BasicMatrix& mat);
     void output_floatLen(unsigned int len); // broken
 
 private:
-    std::vector<std::vector<double>> _data;
+    template <typename U> friend class BasicMatrix;
+    template <typename S>
+    friend BasicMatrix<S> _multiply(const BasicMatrixView<const S>& lhs,
+                                    const BasicMatrixView<const S>& rhs);
+    template <typename T, typename S>
+    friend BasicMatrix<S> operator*(const std::vector<T>& vector,
+                                    const BasicMatrix<S>& rhs);
+    // factorizations write their factors and results through _mutable_data()
+    friend class LU;
+    friend class Cholesky;
+    friend class HouseholderQR;
+    friend class SymmetricEigen;
+    friend class SparseMatrix;
+
+    Scalar* _data = nullptr; // contiguous storage, MATRIX_ALIGNMENT aligned,
+                             // shared by copies until one writes (see _detach)
+    bool _unshareable = false; // mutable access to _data was handed out, so
+                               // copies copy it instead of sharing it
+    std::size_t _ld = 0; // leading dimension (padded distance between rows)
+    std::size_t _capacity = 0; // number of rows allocated in _data
     std::size_t _rows; // number of rows / size of columns
     std::size_t _columns; // number of columns / size of rows
     unsigned int _floatLen; // float length when printing matrix
     double _floatPrecis; // assumed float percision (based on _floatLen)
     std::set<std::size_t> _augment_lines; // location of any augment lines
     bool _niceBrackets = NICE_BRACKET; // weither to use upperscore in brackets
+
+    void _allocate(std::size_t rows, std::size_t columns, bool zero=true);
+    void _reserve(std::size_t rows, std::size_t columns);
+    void _release();
+    void _share(const BasicMatrix& other);
+    bool _shared() const {
+        return _data && _buffer_refs(_data).load(std::memory_order_acquire) != 1;
+    }
+    void _detach();
+    // before handing out mutable access; inline so loops test the flag once
+    void _unshare() {
+        if(!_unshareable) {
+            _detach();
+            _unshareable = true;
+        }
+    }
+    // write access for the library's own results and workspaces: detaches
+    // like any write but, unlike data(), leaves the Matrix shareable so its
+    // copies stay O(1); the pointer must not be kept past the next copy
+    Scalar* _mutable_data() {
+        _detach();
+        return _data;
+    }
+    BasicMatrixView<Scalar> _mutable_view();
+    template <typename E>
+    void _assign(const E& expr);
+    template <typename E>
+    void _update(const E& expr);
 };
 
+template <typename T, typename Scalar>
+BasicMatrix<Scalar> operator*(const std::vector<T>& vector, 
+                              const BasicMatrix<Scalar>& rhs);
+
+/* Unchecked element access, inlined for use in tight loops */
+
+template <typename Scalar>
+inline Scalar& BasicMatrix<Scalar>::operator()(std::size_t row, 
+                                               std::size_t col) {
+    _unshare();
+    return _data[row * _ld + col];
+}
+template <typename Scalar>
+inline const Scalar& BasicMatrix<Scalar>::operator()(std::size_t row, 
+                                                     std::size_t col) const {
+    return _data[row * _ld + col];
+}
+
+#include "matrix_expr.h"
+#include "matrix_view.h"
+#include "lu.h"
+#include "cholesky.h"
+#include "qr.h"
+#include "symmetric_eigen.h"
+#include "sparse.h"
+#include "serialize.h"
+#include "fixed_matrix.h"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,496 @@
+#pragma once
+#ifndef MATRIX_EXPR_H
+#define MATRIX_EXPR_H
+
+#include "matrix.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+/*
+ * Lazy elementwise arithmetic for Matrix
+ * 
+ * A + B, A - B, A * s, s * A and A / s build lightweight expression objects
+ * instead of matrices. Nothing is computed until the expression is assigned
+ * to (or used to construct, or compound-assigned into) a Matrix, at which
+ * point every element is produced by one pass over the rows, so
+ * D = A + B - C * s touches each element of A, B, C and D once and allocates
+ * at most D. Dimensions are still checked when the expression is built.
+ * 
+ * Expressions hold references to the matrices they were built from, so keep
+ * them to a single statement. Storing one in an auto variable dangles as soon
+ * as an operand was a temporary:
+ * 
+ *     auto X = (A + B) + Matrix(2, 2); // X refers to a destroyed Matrix
+ *     Matrix Y = (A + B) + Matrix(2, 2); // fine, evaluated in the statement
+ * 
+ * Every operand of one expression must share an element type (convert
+ * explicitly, e.g. MatrixF(A), to mix Matrix and MatrixF).
+ * 
+ * Matrix members that read a whole Matrix are forwarded by expressions, so
+ * (A + B).inverse() or (A - B) * vector still work: they evaluate the
+ * expression into a temporary Matrix and call the member on it.
+ */
+
+/**
+ * @brief Base of every lazy Matrix expression (CRTP)
+ * 
+ * Derived types provide scalar_type, rows(), columns() and row(i), where
+ * row(i)[j] is element (i, j) of the result, and aliases(dst, rs, cs), true
+ * when writing the result to dst (rows rs and columns cs elements apart)
+ * could overwrite an element the expression has yet to read.
+ */
+template <typename E>
+class MatrixExpr {
+public:
+    const E& self() const { return static_cast<const E&>(*this); }
+    auto eval() const { return BasicMatrix<typename E::scalar_type>(*this); }
+
+    /* Get functions (dimentions without evaluating) */
+
+    int num_rows() const { return self().rows(); }
+    int num_columns() const { return self().columns(); }
+    int size() const { return self().rows() * self().columns(); }
+    bool empty() const { return !(self().rows() && self().columns()); }
+    auto get_row(std::size_t row) const { return eval().get_row(row); }
+    auto get_column(std::size_t col) const { return eval().get_column(col); }
+    auto to_vector() const { return eval().to_vector(); }
+
+    /* Matrix math on the evaluated result */
+
+    template <typename T>
+    auto operator*(const std::vector<T>& vector) const {
+        return eval() * vector;
+    }
+    auto vec_dot() const { return eval().vec_dot(); }
+    double determinant() const { return eval().determinant(); }
+    auto transpose() const { return eval().transpose(); }
+    auto rref() const { return eval().rref(); }
+    auto inverse() const { return eval().inverse(); }
+    auto lu() const { return eval().lu(); }
+    auto cholesky() const { return eval().cholesky(); }
+    // D delays naming E::scalar_type until a call, E is incomplete here
+    template <typename D = E>
+    auto solve(const BasicMatrix<typename D::scalar_type>& B) const {
+        return eval().solve(B);
+    }
+    template <typename D = E>
+    auto solve(const std::vector<typename D::scalar_type>& b) const {
+        return eval().solve(b);
+    }
+    auto qr() const { return eval().qr(); }
+    template <typename D = E>
+    auto qr(typename BasicMatrix<typename D::scalar_type>::QR output) const {
+        return eval().qr(output);
+    }
+    auto eigenvalues_approx(double percision=1e-12,
+                            int max_iterations=100000) const {
+        return eval().eigenvalues_approx(percision, max_iterations);
+    }
+    auto eigenvalues(double percision=1e-12,
+                     int max_iterations=100000) const {
+        return eval().eigenvalues(percision, max_iterations);
+    }
+};
+
+/**
+ * @brief multiply a row vector by the result of an expression
+ * 
+ */
+template <typename T, typename E>
+auto operator*(const std::vector<T>& vector, const MatrixExpr<E>& rhs) {
+    return vector * rhs.eval();
+}
+
+/**
+ * @brief true when rows x columns elements read from src can be clobbered by
+ *        writing rows x columns elements to dst before they are read
+ *        (identical layouts are safe, each element only depends on itself)
+ * 
+ */
+template <typename T>
+bool _conflicts(const T* src, std::size_t srcRs, std::size_t srcCs,
+                const T* dst, std::size_t dstRs, std::size_t dstCs,
+                std::size_t rows, std::size_t columns) {
+    if(!rows || !columns || !src || !dst)
+        return false;
+    if(src == dst && srcRs == dstRs && srcCs == dstCs)
+        return false;
+    const T* srcEnd = src + (rows - 1) * srcRs + (columns - 1) * srcCs + 1;
+    const T* dstEnd = dst + (rows - 1) * dstRs + (columns - 1) * dstCs + 1;
+    std::less<const T*> before;
+    return before(src, dstEnd) && before(dst, srcEnd);
+}
+
+/**
+ * @brief Leaf of an expression: read only reference to a Matrix
+ * 
+ */
+template <typename Scalar>
+class MatrixRef : public MatrixExpr<MatrixRef<Scalar>> {
+public:
+    typedef Scalar scalar_type;
+    static constexpr std::size_t element_flops = 0; // per element evaluated
+
+    MatrixRef(const BasicMatrix<Scalar>& mat) : _mat(mat) {}
+    std::size_t rows() const { return _mat.num_rows(); }
+    std::size_t columns() const { return _mat.num_columns(); }
+    const Scalar* row(std::size_t i) const {
+        return _mat.data() + i * _mat.leading_dim();
+    }
+    bool aliases(const Scalar* dst, std::size_t rs, std::size_t cs) const {
+        return _conflicts(_mat.data(), _mat.leading_dim(), 1, dst, rs, cs,
+                          rows(), columns());
+    }
+private:
+    const BasicMatrix<Scalar>& _mat;
+};
+
+/* Elementwise operations */
+
+struct _AddOp {
+    static constexpr const char* name = "addition";
+    template <typename T> static T apply(T a, T b) { return a + b; }
+};
+struct _SubOp {
+    static constexpr const char* name = "subtraction";
+    template <typename T> static T apply(T a, T b) { return a - b; }
+};
+struct _MulOp {
+    template <typename T> static T apply(T a, T b) { return a * b; }
+};
+struct _DivOp {
+    template <typename T> static T apply(T a, T b) { return a / b; }
+};
+
+/**
+ * @brief Elementwise combination of two equally sized expressions
+ * 
+ */
+template <typename L, typename R, typename Op>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>> {
+public:
+    static_assert(std::is_same<typename L::scalar_type, 
+                               typename R::scalar_type>::value,
+                  "Matricies must have same element type");
+    typedef typename L::scalar_type scalar_type;
+    static constexpr std::size_t element_flops = 
+        L::element_flops + R::element_flops + 1;
+
+    struct Row {
+        decltype(std::declval<L>().row(0)) lhs;
+        decltype(std::declval<R>().row(0)) rhs;
+        scalar_type operator[](std::size_t j) const {
+            return Op::apply(lhs[j], rhs[j]);
+        }
+    };
+
+    MatrixBinaryExpr(const L& lhs, const R& rhs) : _lhs(lhs), _rhs(rhs) {
+        if(!_lhs.rows() || !_rhs.rows())
+            throw std::domain_error("Matricies must have data");
+        if(_lhs.rows() != _rhs.rows() || _lhs.columns() != _rhs.columns())
+            throw std::invalid_argument(
+                std::string("Matricies must have same dimentions for ")
+                + Op::name);
+    }
+    std::size_t rows() const { return _lhs.rows(); }
+    std::size_t columns() const { return _lhs.columns(); }
+    Row row(std::size_t i) const { return Row{_lhs.row(i), _rhs.row(i)}; }
+    bool aliases(const scalar_type* dst, std::size_t rs, std::size_t cs) const {
+        return _lhs.aliases(dst, rs, cs) || _rhs.aliases(dst, rs, cs);
+    }
+private:
+    L _lhs;
+    R _rhs;
+};
+
+/**
+ * @brief Every element of an expression combined with one scalar
+ * 
+ */
+template <typename E, typename Op>
+class MatrixScalarExpr : public MatrixExpr<MatrixScalarExpr<E, Op>> {
+public:
+    typedef typename E::scalar_type scalar_type;
+    static constexpr std::size_t element_flops = E::element_flops + 1;
+
+    struct Row {
+        decltype(std::declval<E>().row(0)) expr;
+        scalar_type scale;
+        scalar_type operator[](std::size_t j) const {
+            return Op::apply(expr[j], scale);
+        }
+    };
+
+    MatrixScalarExpr(const E& expr, scalar_type scale)
+            : _expr(expr), _scale(scale) {
+        if(!_expr.rows())
+            throw std::domain_error("Matrix must have data");
+    }
+    std::size_t rows() const { return _expr.rows(); }
+    std::size_t columns() const { return _expr.columns(); }
+    Row row(std::size_t i) const { return Row{_expr.row(i), _scale}; }
+    bool aliases(const scalar_type* dst, std::size_t rs, std::size_t cs) const {
+        return _expr.aliases(dst, rs, cs);
+    }
+private:
+    E _expr;
+    scalar_type _scale;
+};
+
+/* Operand traits: Matrix is wrapped in a MatrixRef, expressions are copied */
+
+template <typename T> struct _IsMatrix : std::false_type {};
+template <typename S> struct _IsMatrix<BasicMatrix<S>> : std::true_type {};
+
+template <typename T> struct _ExprOperand { typedef T type; };
+template <typename S> struct _ExprOperand<BasicMatrix<S>> {
+    typedef MatrixRef<S> type;
+};
+template <typename T> using _expr_t = typename _ExprOperand<T>::type;
+
+template <typename T>
+struct _IsExprOperand : std::integral_constant<bool,
+    _IsMatrix<T>::value || std::is_base_of<MatrixExpr<T>, T>::value
+> {};
+
+template <typename L, typename R>
+using _enable_binary_t = typename std::enable_if<
+    _IsExprOperand<L>::value && _IsExprOperand<R>::value>::type;
+template <typename E>
+using _enable_unary_t = typename std::enable_if<_IsExprOperand<E>::value>::type;
+
+/**
+ * @brief Add Matricies with equal dimentions
+ * 
+ */
+template <typename L, typename R, typename = _enable_binary_t<L, R>>
+MatrixBinaryExpr<_expr_t<L>, _expr_t<R>, _AddOp>
+operator+(const L& lhs, const R& rhs) {
+    return MatrixBinaryExpr<_expr_t<L>, _expr_t<R>, _AddOp>(lhs, rhs);
+}
+/**
+ * @brief Subtract Matricies with equal dimentions
+ * 
+ */
+template <typename L, typename R, typename = _enable_binary_t<L, R>>
+MatrixBinaryExpr<_expr_t<L>, _expr_t<R>, _SubOp>
+operator-(const L& lhs, const R& rhs) {
+    return MatrixBinaryExpr<_expr_t<L>, _expr_t<R>, _SubOp>(lhs, rhs);
+}
+
+/**
+ * @brief multiply Matrix by scale (in the Matrix element type)
+ * 
+ */
+template <typename E, typename = _enable_unary_t<E>>
+MatrixScalarExpr<_expr_t<E>, _MulOp> operator*(const E& lhs, double scale) {
+    return MatrixScalarExpr<_expr_t<E>, _MulOp>(lhs, scale);
+}
+/**
+ * @brief multiply Matrix by scale (in the Matrix element type)
+ * 
+ */
+template <typename E, typename = _enable_unary_t<E>>
+MatrixScalarExpr<_expr_t<E>, _MulOp> operator*(double scale, const E& rhs) {
+    return MatrixScalarExpr<_expr_t<E>, _MulOp>(rhs, scale);
+}
+/**
+ * @brief divide Matrix by scale (in the Matrix element type)
+ * 
+ */
+template <typename E, typename = _enable_unary_t<E>>
+MatrixScalarExpr<_expr_t<E>, _DivOp> operator/(const E& lhs, double scale) {
+    if(scale == 0)
+        throw std::invalid_argument("scale cannot be zero");
+    return MatrixScalarExpr<_expr_t<E>, _DivOp>(lhs, scale);
+}
+
+/**
+ * @brief print the result of an expression
+ * 
+ */
+template <typename E>
+std::ostream& operator<<(std::ostream &os, const MatrixExpr<E>& expr) {
+    return os << expr.eval();
+}
+
+/* Matrix members taking expressions */
+
+/**
+ * @brief Construct a Matrix by evaluating an expression
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+BasicMatrix<Scalar>::BasicMatrix(const MatrixExpr<E>& expr) : BasicMatrix() {
+    static_assert(std::is_same<Scalar, typename E::scalar_type>::value,
+                  "Matricies must have same element type");
+    _assign(expr.self());
+}
+
+/**
+ * @brief set Matrix to the result of an expression (does not change float
+ *        lenght); the Matrix may appear in the expression
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+BasicMatrix<Scalar>& BasicMatrix<Scalar>::operator=(const MatrixExpr<E>& expr) {
+    static_assert(std::is_same<Scalar, typename E::scalar_type>::value,
+                  "Matricies must have same element type");
+    _assign(expr.self());
+    _augment_lines.clear();
+    return *this;
+}
+
+/**
+ * @brief Incriment Matrix by an expression with equal dimentions
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+BasicMatrix<Scalar>& 
+BasicMatrix<Scalar>::operator+=(const MatrixExpr<E>& expr) {
+    if(expr.self().aliases(_data, _ld, 1))
+        return *this += expr.eval();
+    MATRIX_OP("elementwise", _rows, _columns,
+              (E::element_flops + 1.0) * _rows * _columns);
+    _update(MatrixBinaryExpr<MatrixRef<Scalar>, E, _AddOp>(*this, expr.self()));
+    return *this;
+}
+/**
+ * @brief Deincriment Matrix by an expression with equal dimentions
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+BasicMatrix<Scalar>& 
+BasicMatrix<Scalar>::operator-=(const MatrixExpr<E>& expr) {
+    if(expr.self().aliases(_data, _ld, 1))
+        return *this -= expr.eval();
+    MATRIX_OP("elementwise", _rows, _columns,
+              (E::element_flops + 1.0) * _rows * _columns);
+    _update(MatrixBinaryExpr<MatrixRef<Scalar>, E, _SubOp>(*this, expr.self()));
+    return *this;
+}
+
+/**
+ * @brief copies expr into dst (row stride ld) with a specialised kernel when
+ *        its layout allows one (overloaded in matrix_view.h)
+ * 
+ * @return false when nothing was copied
+ */
+template <typename E, typename T>
+bool _copy_fast(const E&, T*, std::size_t) {
+    return false;
+}
+/**
+ * @brief A + B and A - B with the vector kernels
+ * 
+ */
+template <typename S, typename Op>
+bool _copy_fast(const MatrixBinaryExpr<MatrixRef<S>, MatrixRef<S>, Op>& expr,
+                S* dst, std::size_t ld) {
+    const S alpha = std::is_same<Op, _SubOp>::value ? -1 : 1;
+    const std::size_t columns = expr.columns();
+    _for_rows(expr.rows(), columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            const auto src = expr.row(i);
+            _simd_axpy(columns, alpha, src.rhs, src.lhs, dst + i*ld);
+        }
+    });
+    return true;
+}
+/**
+ * @brief A + B * s and A - B * s with the vector kernels
+ * 
+ */
+template <typename S, typename Op>
+bool _copy_fast(const MatrixBinaryExpr<MatrixRef<S>, 
+                    MatrixScalarExpr<MatrixRef<S>, _MulOp>, Op>& expr,
+                S* dst, std::size_t ld) {
+    const std::size_t columns = expr.columns();
+    _for_rows(expr.rows(), columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            const auto src = expr.row(i);
+            const S alpha = std::is_same<Op, _SubOp>::value 
+                                ? -src.rhs.scale : src.rhs.scale;
+            _simd_axpy(columns, alpha, src.rhs.expr, src.lhs, dst + i*ld);
+        }
+    });
+    return true;
+}
+/**
+ * @brief A * s with the vector kernels
+ * 
+ */
+template <typename S>
+bool _copy_fast(const MatrixScalarExpr<MatrixRef<S>, _MulOp>& expr,
+                S* dst, std::size_t ld) {
+    const std::size_t columns = expr.columns();
+    _for_rows(expr.rows(), columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            const auto src = expr.row(i);
+            _simd_scale(columns, src.scale, src.expr, dst + i*ld);
+        }
+    });
+    return true;
+}
+
+/**
+ * @brief evaluates expr into this Matrix in one pass over its rows, reusing
+ *        the current buffer when it is large enough, not shared with a copy,
+ *        and expr does not read it out of place (e.g. A = A.block(1, 1, 2, 2))
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+void BasicMatrix<Scalar>::_assign(const E& expr) {
+    std::size_t rows = expr.rows(), columns = expr.columns();
+    MATRIX_OP("elementwise", rows, columns, 
+              double(E::element_flops) * rows * columns);
+    // a shared buffer must not be written, and expr may still read it
+    if(_shared() || expr.aliases(_data, _ld, 1)) {
+        BasicMatrix result;
+        result._allocate(rows, columns, false);
+        result._update(expr);
+        std::swap(_data, result._data);
+        std::swap(_ld, result._ld);
+        std::swap(_capacity, result._capacity);
+        _rows = rows;
+        _columns = columns;
+        return;
+    }
+    if(_capacity < rows || _ld < columns)
+        _allocate(rows, columns, false);
+    _rows = rows;
+    _columns = columns;
+    _update(expr);
+}
+/**
+ * @brief overwrites every element with expr, which has the same dimentions
+ *        and may read this Matrix (elementwise reads never see a written
+ *        element from another position)
+ * 
+ */
+template <typename Scalar>
+template <typename E>
+void BasicMatrix<Scalar>::_update(const E& expr) {
+    _detach();
+    if(_copy_fast(expr, _data, _ld))
+        return;
+    _for_rows(_rows, _columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            Scalar* dst = _data + i*_ld;
+            const auto src = expr.row(i);
+            #pragma GCC ivdep // dst[j] only ever depends on position j
+            for(std::size_t j=0; j<_columns; ++j)
+                dst[j] = src[j];
+        }
+    });
+}
+
+#endif
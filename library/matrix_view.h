@@ -0,0 +1,462 @@
+#pragma once
+#ifndef MATRIX_VIEW_H
+#define MATRIX_VIEW_H
+
+#include "matrix.h"
+#include "matrix_expr.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <type_traits>
+
+/*
+ * Non-owning views into Matrix storage
+ *
+ * row_view(), column_view() and block() return a view instead of a copy: a
+ * pointer plus row and column strides into the Matrix they came from. Views
+ * read and write the original elements, can be sliced again, take part in
+ * lazy expressions (A.block(0, 0, 2, 2) = B.row_view(1) * 2 ...) and in
+ * products, which run straight on the strided storage. A view must not
+ * outlive its Matrix, or be used after the Matrix is resized. transpose() of a
+ * view swaps its strides, so A.transpose_view() * B multiplies by A^T without
+ * moving A, and copying a transposed view uses the tiled transpose kernel.
+ *
+ * BasicMatrixView<const Scalar> is the read only view returned from a const
+ * Matrix. Assigning to a view overwrites the viewed elements (it does not
+ * rebind the view); an expression reading storage that overlaps the
+ * destination is evaluated into a temporary first.
+ */
+
+/**
+ * @brief rows x columns window into row-major storage; element (i, j) is
+ *        data[i*rowStride + j*columnStride]
+ *
+ */
+template <typename Scalar>
+class BasicMatrixView : public MatrixExpr<BasicMatrixView<Scalar>> {
+public:
+    typedef typename std::remove_const<Scalar>::type scalar_type;
+    static constexpr std::size_t element_flops = 0; // per element evaluated
+
+    /**
+     * @brief one row of the view, indexable by column
+     *
+     */
+    struct Row {
+        Scalar* ptr;
+        std::size_t stride;
+        Scalar& operator[](std::size_t j) const { return ptr[j * stride]; }
+    };
+
+    /* Constructors */
+
+    BasicMatrixView(Scalar* data, std::size_t rows, std::size_t columns,
+                    std::size_t rowStride, std::size_t columnStride=1)
+            : _data(data), _rows(rows), _columns(columns),
+              _rs(rowStride), _cs(columnStride) {}
+    BasicMatrixView(BasicMatrix<scalar_type>& mat)
+            : BasicMatrixView(mat.data(), mat.num_rows(), mat.num_columns(),
+                              mat.leading_dim()) {}
+    template <typename M, typename = typename std::enable_if<
+                  std::is_same<M, BasicMatrix<scalar_type>>::value
+                  && std::is_const<Scalar>::value>::type>
+    BasicMatrixView(const M& mat) // read only views only
+            : BasicMatrixView(mat.data(), mat.num_rows(), mat.num_columns(),
+                              mat.leading_dim()) {}
+    template <typename T, typename = typename std::enable_if<
+                  std::is_same<const T, Scalar>::value>::type>
+    BasicMatrixView(const BasicMatrixView<T>& other)
+            : BasicMatrixView(other.data(), other.rows(), other.columns(),
+                              other.row_stride(), other.column_stride()) {}
+    BasicMatrixView(const BasicMatrixView& other) = default;
+
+    /* Get functions */
+
+    std::size_t rows() const { return _rows; }
+    std::size_t columns() const { return _columns; }
+    std::size_t row_stride() const { return _rs; }
+    std::size_t column_stride() const { return _cs; }
+    Scalar* data() const { return _data; }
+    bool empty() const { return !(_rows && _columns); }
+    Row row(std::size_t i) const { return Row{_data + i*_rs, _cs}; }
+    Scalar& operator()(std::size_t row, std::size_t col) const {
+        return _data[row*_rs + col*_cs];
+    }
+    Scalar& at(std::size_t row, std::size_t col) const;
+
+    /* Slicing */
+
+    BasicMatrixView row_view(std::size_t row) const;
+    BasicMatrixView column_view(std::size_t col) const;
+    BasicMatrixView block(std::size_t row, std::size_t col, std::size_t rows,
+                          std::size_t columns, std::size_t rowStep=1,
+                          std::size_t colStep=1) const;
+    BasicMatrixView transpose() const;
+
+    /* Edit functions (write through to the viewed Matrix) */
+
+    const BasicMatrixView& operator=(const BasicMatrixView& other) const;
+    const BasicMatrixView& operator=(const BasicMatrix<scalar_type>& mat) const;
+    template <typename E>
+    const BasicMatrixView& operator=(const MatrixExpr<E>& expr) const;
+    template <typename E>
+    const BasicMatrixView& operator+=(const MatrixExpr<E>& expr) const;
+    template <typename E>
+    const BasicMatrixView& operator-=(const MatrixExpr<E>& expr) const;
+    const BasicMatrixView& operator+=(const BasicMatrix<scalar_type>& mat) const;
+    const BasicMatrixView& operator-=(const BasicMatrix<scalar_type>& mat) const;
+    const BasicMatrixView& operator*=(scalar_type scale) const;
+    const BasicMatrixView& operator/=(scalar_type scale) const;
+    void fill(scalar_type value) const;
+    void multiply_add(const BasicMatrixView<const scalar_type>& A,
+                      const BasicMatrixView<const scalar_type>& B,
+                      scalar_type alpha=1, scalar_type beta=1,
+                      bool transposeA=false, bool transposeB=false) const;
+
+    /* Expression support */
+
+    bool aliases(const scalar_type* dst, std::size_t rs, std::size_t cs) const {
+        return _conflicts<scalar_type>(_data, _rs, _cs, dst, rs, cs,
+                                       _rows, _columns);
+    }
+
+private:
+    Scalar* _data;
+    std::size_t _rows;
+    std::size_t _columns;
+    std::size_t _rs; // distance between rows (elements)
+    std::size_t _cs; // distance between columns (elements)
+
+    template <typename E>
+    void _check(const E& expr, const char* operation) const;
+    template <typename E>
+    void _update(const E& expr) const;
+};
+
+typedef BasicMatrixView<double> MatrixView;
+typedef BasicMatrixView<const double> ConstMatrixView;
+typedef BasicMatrixView<float> MatrixFView;
+typedef BasicMatrixView<const float> ConstMatrixFView;
+
+/**
+ * @brief C = A * B straight from strided storage (no operand is copied)
+ *
+ */
+template <typename Scalar>
+BasicMatrix<Scalar> _multiply(const BasicMatrixView<const Scalar>& lhs,
+                              const BasicMatrixView<const Scalar>& rhs);
+/**
+ * @brief C = alpha * A * B + beta * C in place of C (C is not read when beta
+ *        is zero)
+ *
+ */
+template <typename Scalar>
+void _multiply_add(Scalar alpha, const BasicMatrixView<const Scalar>& A,
+                   const BasicMatrixView<const Scalar>& B, Scalar beta,
+                   const BasicMatrixView<Scalar>& C);
+
+#pragma region GET_FUNCTIONS
+
+/**
+ * @param row row of view
+ * @param col column of view
+ * @return element at given row and column
+ */
+template <typename Scalar>
+Scalar& BasicMatrixView<Scalar>::at(std::size_t row, std::size_t col) const {
+    if(row >= _rows || col >= _columns)
+        throw std::out_of_range("Index does not exist");
+    return (*this)(row, col);
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region SLICING
+
+/**
+ * @return view of one row (1 x columns)
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar>
+BasicMatrixView<Scalar>::row_view(std::size_t row) const {
+    if(row >= _rows)
+        throw std::out_of_range("Row does not exist");
+    return BasicMatrixView(_data + row*_rs, 1, _columns, _rs, _cs);
+}
+/**
+ * @return view of one column (rows x 1)
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar>
+BasicMatrixView<Scalar>::column_view(std::size_t col) const {
+    if(col >= _columns)
+        throw std::out_of_range("Column does not exist");
+    return BasicMatrixView(_data + col*_cs, _rows, 1, _rs, _cs);
+}
+/**
+ * @brief view of rows x columns elements starting at (row, col), taking
+ *        every rowStep-th row and colStep-th column
+ *
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar>
+BasicMatrixView<Scalar>::block(std::size_t row, std::size_t col,
+                               std::size_t rows, std::size_t columns,
+                               std::size_t rowStep,
+                               std::size_t colStep) const {
+    if(!rows || !columns || !rowStep || !colStep)
+        throw std::invalid_argument("Block cannot be empty");
+    if(row >= _rows || (rows - 1) * rowStep >= _rows - row
+       || col >= _columns || (columns - 1) * colStep >= _columns - col)
+        throw std::out_of_range("Block does not fit in Matrix");
+    return BasicMatrixView(_data + row*_rs + col*_cs, rows, columns,
+                           _rs * rowStep, _cs * colStep);
+}
+
+/**
+ * @return view of the transpose (strides swapped, nothing is moved)
+ */
+template <typename Scalar>
+BasicMatrixView<Scalar> BasicMatrixView<Scalar>::transpose() const {
+    return BasicMatrixView(_data, _columns, _rows, _cs, _rs);
+}
+
+#pragma endregion // SLICING
+/******************************************************************************/
+#pragma region EDIT_FUNCTIONS
+
+/**
+ * @brief copy the elements of other into the viewed elements
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator=(const BasicMatrixView& other) const {
+    return *this = static_cast<const MatrixExpr<BasicMatrixView>&>(other);
+}
+/**
+ * @brief copy the elements of mat into the viewed elements
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator=(const BasicMatrix<scalar_type>& mat) const {
+    return *this = MatrixRef<scalar_type>(mat);
+}
+/**
+ * @brief evaluate expr into the viewed elements
+ *
+ */
+template <typename Scalar>
+template <typename E>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator=(const MatrixExpr<E>& expr) const {
+    _check(expr.self(), "assignment");
+    if(expr.self().aliases(_data, _rs, _cs)) {
+        BasicMatrix<scalar_type> temp(expr);
+        _update(MatrixRef<scalar_type>(temp));
+    } else {
+        _update(expr.self());
+    }
+    return *this;
+}
+
+/**
+ * @brief Incriment viewed elements by an expression with equal dimentions
+ *
+ */
+template <typename Scalar>
+template <typename E>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator+=(const MatrixExpr<E>& expr) const {
+    _check(expr.self(), "addition");
+    return *this = MatrixBinaryExpr<BasicMatrixView, E, _AddOp>(*this,
+                                                              expr.self());
+}
+/**
+ * @brief Deincriment viewed elements by an expression with equal dimentions
+ *
+ */
+template <typename Scalar>
+template <typename E>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator-=(const MatrixExpr<E>& expr) const {
+    _check(expr.self(), "subtraction");
+    return *this = MatrixBinaryExpr<BasicMatrixView, E, _SubOp>(*this,
+                                                              expr.self());
+}
+/**
+ * @brief Incriment viewed elements by a Matrix with equal dimentions
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator+=(const BasicMatrix<scalar_type>& mat) const {
+    return *this += MatrixRef<scalar_type>(mat);
+}
+/**
+ * @brief Deincriment viewed elements by a Matrix with equal dimentions
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator-=(const BasicMatrix<scalar_type>& mat) const {
+    return *this -= MatrixRef<scalar_type>(mat);
+}
+
+/**
+ * @brief multiply viewed elements by scale
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator*=(scalar_type scale) const {
+    if(empty())
+        throw std::domain_error("Matrix must have data");
+    _update(MatrixScalarExpr<BasicMatrixView, _MulOp>(*this, scale));
+    return *this;
+}
+/**
+ * @brief divide viewed elements by scale
+ *
+ */
+template <typename Scalar>
+const BasicMatrixView<Scalar>&
+BasicMatrixView<Scalar>::operator/=(scalar_type scale) const {
+    if(scale == 0)
+        throw std::invalid_argument("scale cannot be zero");
+    if(empty())
+        throw std::domain_error("Matrix must have data");
+    _update(MatrixScalarExpr<BasicMatrixView, _DivOp>(*this, scale));
+    return *this;
+}
+
+/**
+ * @brief set every viewed element to value
+ *
+ */
+template <typename Scalar>
+void BasicMatrixView<Scalar>::fill(scalar_type value) const {
+    _for_rows(_rows, _columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            Row dst = row(i);
+            for(std::size_t j=0; j<_columns; ++j)
+                dst[j] = value;
+        }
+    });
+}
+
+/**
+ * @brief throws unless expr can be written into this view
+ *
+ */
+template <typename Scalar>
+template <typename E>
+void BasicMatrixView<Scalar>::_check(const E& expr,
+                                     const char* operation) const {
+    static_assert(std::is_same<scalar_type, typename E::scalar_type>::value,
+                  "Matricies must have same element type");
+    if(expr.rows() != _rows || expr.columns() != _columns)
+        throw std::invalid_argument(
+            std::string("Matricies must have same dimentions for ")
+            + operation);
+}
+/**
+ * @brief overwrites every viewed element with expr, which has the same
+ *        dimentions and does not read a different position of this view
+ *
+ */
+template <typename Scalar>
+template <typename E>
+void BasicMatrixView<Scalar>::_update(const E& expr) const {
+    _for_rows(_rows, _columns, [&](std::size_t lo, std::size_t hi) {
+        for(std::size_t i=lo; i<hi; ++i) {
+            Scalar* dst = _data + i*_rs;
+            const auto src = expr.row(i);
+            if(_cs == 1) {
+                #pragma GCC ivdep // dst[j] only ever depends on position j
+                for(std::size_t j=0; j<_columns; ++j)
+                    dst[j] = src[j];
+            } else {
+                for(std::size_t j=0; j<_columns; ++j)
+                    dst[j*_cs] = src[j];
+            }
+        }
+    });
+}
+
+/**
+ * @brief copies a transposed view (contiguous columns) into dst with the
+ *        tiled transpose kernel instead of strided row reads
+ * 
+ * @return false when view is not laid out as a transpose
+ */
+template <typename S, typename T>
+bool _copy_fast(const BasicMatrixView<S>& view, T* dst, std::size_t ld) {
+    if(view.row_stride() != 1 || view.column_stride() == 1)
+        return false;
+    _transpose<T>(view.columns(), view.rows(), view.data(),
+                  view.column_stride(), dst, ld);
+    return true;
+}
+
+#pragma endregion // EDIT_FUNCTIONS
+/******************************************************************************/
+#pragma region PRODUCTS
+
+/**
+ * @brief product operand without copying: Matrix and views are used in place,
+ *        other expressions are evaluated once
+ *
+ */
+template <typename S>
+BasicMatrixView<const S> _product_operand(const BasicMatrix<S>& mat) {
+    return BasicMatrixView<const S>(mat);
+}
+template <typename S>
+BasicMatrixView<const S> _product_operand(const BasicMatrixView<S>& view) {
+    return BasicMatrixView<const S>(view);
+}
+template <typename E>
+BasicMatrix<typename E::scalar_type>
+_product_operand(const MatrixExpr<E>& expr) {
+    return expr.eval();
+}
+
+/**
+ * @brief Multiply Matricices when either side is a view or an expression
+ *        (views are read in place, expressions are evaluated first)
+ *
+ */
+template <typename L, typename R, typename = _enable_binary_t<L, R>,
+          typename = typename std::enable_if<
+              !(_IsMatrix<L>::value && _IsMatrix<R>::value)>::type>
+BasicMatrix<typename _expr_t<L>::scalar_type>
+operator*(const L& lhs, const R& rhs) {
+    typedef typename _expr_t<L>::scalar_type Scalar;
+    static_assert(std::is_same<Scalar, typename _expr_t<R>::scalar_type>::value,
+                  "Matricies must have same element type");
+    const auto& left = _product_operand(lhs);
+    const auto& right = _product_operand(rhs);
+    return _multiply<Scalar>(left, right);
+}
+
+/**
+ * @brief viewed elements = alpha * op(A) * op(B) + beta * viewed elements,
+ *        where op() transposes when the matching flag is set (no allocation
+ *        unless this view has strided columns or shares storage with A or B)
+ *
+ */
+template <typename Scalar>
+void BasicMatrixView<Scalar>::multiply_add(
+        const BasicMatrixView<const scalar_type>& A,
+        const BasicMatrixView<const scalar_type>& B,
+        scalar_type alpha, scalar_type beta,
+        bool transposeA, bool transposeB) const {
+    _multiply_add<scalar_type>(alpha, transposeA ? A.transpose() : A,
+                               transposeB ? B.transpose() : B, beta, *this);
+}
+
+#pragma endregion // PRODUCTS
+
+#endif
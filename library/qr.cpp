@@ -0,0 +1,318 @@
+#include "qr.h"
+#include "kernels.h"
+#include <stdexcept>
+#include <cmath>
+#include <cstring> // memcpy()
+#include <limits>
+
+using namespace std;
+
+#define QR_BLOCK 32 // reflectors grouped into one block update
+
+#pragma region CONSTRUCTORS
+
+/**
+ * @brief Factor a Matrix
+ * 
+ * @param A Matrix to factor (copied)
+ */
+HouseholderQR::HouseholderQR(const Matrix& A) : _qr(A) {
+    _factor();
+}
+/**
+ * @brief Factor a Matrix in place of its storage
+ * 
+ * @param A Matrix to factor (moved from)
+ */
+HouseholderQR::HouseholderQR(Matrix&& A) : _qr(move(A)) {
+    _factor();
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region GET_FUNCTIONS
+
+/**
+ * @return true if the columns are linearly independant (no diagonal element
+ *         of R is zero relative to the largest)
+ */
+bool HouseholderQR::full_rank() const {
+    return _fullRank;
+}
+
+/**
+ * @return packed factors: R on and above the diagonal, Householder vectors
+ *         (with implied leading 1) below
+ */
+const Matrix& HouseholderQR::factors() const {
+    return _qr;
+}
+
+/**
+ * @return scale of each reflector, H_j = I - tau[j] * v_j * v_j^T
+ */
+const vector<double>& HouseholderQR::tau() const {
+    return _tau;
+}
+
+/**
+ * @return thin orthonormal factor Q (m x min(m, n))
+ */
+Matrix HouseholderQR::Q() const {
+    const size_t m = _qr.num_rows(), k = _tau.size();
+    MATRIX_OP("qr_form_q", m, k, 2.0 * m * k * k - 2.0 / 3.0 * k * k * k);
+    Matrix Q_matrix(m, k);
+    double* q = Q_matrix._mutable_data();
+    const size_t ldq = Q_matrix.leading_dim();
+    for(size_t i=0; i<k; ++i)
+        q[i*ldq + i] = 1;
+    vector<double> V;
+    for(size_t j0=(k-1)/QR_BLOCK*QR_BLOCK;; j0-=QR_BLOCK) { // last block first
+        size_t nb = min<size_t>(QR_BLOCK, k - j0);
+        _explicit_v(j0, nb, V);
+        // columns left of j0 are still zero below row j0
+        _apply_block(j0, nb, false, q + j0*ldq + j0, ldq,
+                     k - j0, V);
+        if(j0 == 0)
+            break;
+    }
+    for(size_t i=0; i<m; ++i)
+        for(size_t j=0; j<k; ++j)
+            if(_qr(j, j) < 0)
+                q[i*ldq + j] = -q[i*ldq + j];
+    return Q_matrix;
+}
+
+/**
+ * @return upper triangular factor R (min(m, n) x n)
+ */
+Matrix HouseholderQR::R() const {
+    const size_t n = _qr.num_columns(), k = _tau.size();
+    Matrix R_matrix(k, n);
+    double* r = R_matrix._mutable_data();
+    const size_t ldr = R_matrix.leading_dim();
+    for(size_t i=0; i<k; ++i) {
+        double sign = _qr(i, i) < 0 ? -1 : 1;
+        for(size_t j=i; j<n; ++j)
+            r[i*ldr + j] = sign * _qr(i, j);
+    }
+    return R_matrix;
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region MATH_FUNCTIONS
+
+/**
+ * @brief B = Q * B without forming Q
+ * 
+ * @param B Matrix (or view) with as many rows as the factored Matrix
+ */
+void HouseholderQR::apply_q(MatrixView B) const {
+    _apply(false, B);
+}
+/**
+ * @brief B = Q^T * B without forming Q
+ * 
+ * @param B Matrix (or view) with as many rows as the factored Matrix
+ */
+void HouseholderQR::apply_qt(MatrixView B) const {
+    _apply(true, B);
+}
+
+/**
+ * @brief Least squares solution X minimizing |A * X - B| (exact solution when
+ *        A is square)
+ * 
+ * @param B right hand sides, one per column (rows must match A)
+ */
+Matrix HouseholderQR::solve(const Matrix& B) const {
+    const size_t n = _qr.num_columns();
+    if((size_t)_qr.num_rows() < n)
+        throw invalid_argument(
+            "Matrix must have at least as many rows as columns");
+    if(!_fullRank)
+        throw invalid_argument("Columns must be linearly independant");
+    Matrix Y(B);
+    apply_qt(Y._mutable_view());
+    const size_t k = Y.num_columns(), ldy = Y.leading_dim();
+    double* y = Y._mutable_data();
+    _trsm(false, false, n, k, _qr.data(), _qr.leading_dim(), 1, y, ldy);
+    Matrix X(n, k);
+    double* x = X._mutable_data();
+    for(size_t i=0; i<n; ++i)
+        memcpy(x + i*X.leading_dim(), y + i*ldy, k * sizeof(double));
+    return X;
+}
+
+#pragma endregion // MATH_FUNCTIONS
+/******************************************************************************/
+#pragma region FACTORIZATION
+
+/**
+ * @brief blocked Householder QR: factor a QR_BLOCK wide panel column by
+ *        column, build its T, then apply the whole block to the trailing
+ *        columns with three _gemm calls
+ * 
+ */
+void HouseholderQR::_factor() {
+    if(_qr.empty())
+        throw invalid_argument("Matrix must have data");
+    const size_t m = _qr.num_rows(), n = _qr.num_columns();
+    const size_t k = min(m, n), ld = _qr.leading_dim();
+    MATRIX_OP("householder_qr", m, n,
+              2.0 * max(m, n) * k * k - 2.0 / 3.0 * k * k * k);
+    _tau.assign(k, 0);
+    _t = Matrix(k, QR_BLOCK);
+    vector<double> V;
+    for(size_t j0=0; j0<k; j0+=QR_BLOCK) {
+        size_t nb = min<size_t>(QR_BLOCK, k - j0), j1 = j0 + nb;
+        MATRIX_TRACE_SPAN("qr panel", m - j0, n - j0, (long)j0);
+        _factor_panel(j0, nb);
+        _explicit_v(j0, nb, V);
+        _form_t(j0, nb, V);
+        if(j1 < n)
+            _apply_block(j0, nb, true, _qr._mutable_data() + j0*ld + j1, ld,
+                         n - j1, V);
+    }
+    const Matrix& factored = _qr; // const reads keep _qr shareable
+    double largest = 0;
+    for(size_t i=0; i<k; ++i)
+        largest = max(largest, fabs(factored(i, i)));
+    double tolerance = largest * max(m, n) * numeric_limits<double>::epsilon();
+    _fullRank = k == n;
+    for(size_t i=0; i<k && _fullRank; ++i)
+        if(fabs(factored(i, i)) <= tolerance)
+            _fullRank = false;
+}
+
+/**
+ * @brief unblocked Householder QR of columns [j0, j0+nb) over rows [j0, m);
+ *        reflectors are only applied inside the panel
+ * 
+ */
+void HouseholderQR::_factor_panel(size_t j0, size_t nb) {
+    const size_t m = _qr.num_rows(), ld = _qr.leading_dim(), j1 = j0 + nb;
+    double* a = _qr._mutable_data();
+    vector<double> w(nb);
+    for(size_t j=j0; j<j1; ++j) {
+        double alpha = a[j*ld + j], sigma = 0;
+        for(size_t i=j+1; i<m; ++i)
+            sigma += a[i*ld + j] * a[i*ld + j];
+        if(sigma == 0) // already zero below the diagonal, H = I
+            continue;
+        double norm = sqrt(alpha*alpha + sigma);
+        double beta = alpha > 0 ? -norm : norm; // avoids cancellation
+        double tau = _tau[j] = (beta - alpha) / beta;
+        double scale = 1 / (alpha - beta);
+        for(size_t i=j+1; i<m; ++i)
+            a[i*ld + j] *= scale;
+        a[j*ld + j] = beta;
+        // w = v^T * A(j:m, j+1:j1), then A -= tau * v * w
+        for(size_t c=j+1; c<j1; ++c)
+            w[c-j0] = a[j*ld + c];
+        for(size_t i=j+1; i<m; ++i) {
+            const double v = a[i*ld + j];
+            const double* row = a + i*ld;
+            for(size_t c=j+1; c<j1; ++c)
+                w[c-j0] += v * row[c];
+        }
+        for(size_t c=j+1; c<j1; ++c)
+            a[j*ld + c] -= tau * w[c-j0];
+        for(size_t i=j+1; i<m; ++i) {
+            const double v = tau * a[i*ld + j];
+            double* row = a + i*ld;
+            for(size_t c=j+1; c<j1; ++c)
+                row[c] -= v * w[c-j0];
+        }
+    }
+}
+
+/**
+ * @brief copies the reflectors of block [j0, j0+nb) into V ((m-j0) x nb, row
+ *        stride nb) with the implied ones and zeros written out
+ * 
+ */
+void HouseholderQR::_explicit_v(size_t j0, size_t nb, vector<double>& V) const {
+    const size_t rows = _qr.num_rows() - j0;
+    V.assign(rows * nb, 0);
+    for(size_t p=0; p<rows; ++p) {
+        const double* row = _qr.data() + (j0 + p)*_qr.leading_dim() + j0;
+        for(size_t i=0; i<nb && i<=p; ++i)
+            V[p*nb + i] = i == p ? 1 : row[i];
+    }
+}
+
+/**
+ * @brief builds upper triangular T so H_j0 * ... * H_(j0+nb-1) equals
+ *        I - V * T * V^T
+ * 
+ */
+void HouseholderQR::_form_t(size_t j0, size_t nb, const vector<double>& V) {
+    const size_t rows = _qr.num_rows() - j0, ldt = _t.leading_dim();
+    double* t = _t._mutable_data() + j0*ldt;
+    for(size_t i=0; i<nb; ++i) {
+        const double tau = _tau[j0 + i];
+        t[i*ldt + i] = tau;
+        for(size_t r=0; r<i; ++r) { // z = V(:, 0:i)^T * v_i
+            double z = 0;
+            for(size_t p=i; p<rows; ++p)
+                z += V[p*nb + r] * V[p*nb + i];
+            t[r*ldt + i] = z;
+        }
+        for(size_t r=0; r<i; ++r) { // T(0:i, i) = -tau * T(0:i, 0:i) * z
+            double sum = 0;
+            for(size_t q=r; q<i; ++q)
+                sum += t[r*ldt + q] * t[q*ldt + i];
+            t[r*ldt + i] = -tau * sum;
+        }
+    }
+}
+
+/**
+ * @brief C = (I - V * op(T) * V^T) * C for the block starting at j0, where
+ *        op(T) is T^T when transpose is set; C has m-j0 rows
+ * 
+ */
+void HouseholderQR::_apply_block(size_t j0, size_t nb, bool transpose,
+                                 double* C, size_t ldc, size_t columns,
+                                 const vector<double>& V) const {
+    const size_t rows = _qr.num_rows() - j0, ldt = _t.leading_dim();
+    const double* t = _t.data() + j0*ldt;
+    vector<double> W(nb * columns), TW(nb * columns);
+    _gemm(nb, columns, rows, 1.0, V.data(), 1, nb, C, ldc, 1,
+          0.0, W.data(), columns);
+    _gemm(nb, columns, nb, 1.0, t, transpose ? 1 : ldt, transpose ? ldt : 1,
+          W.data(), columns, 1, 0.0, TW.data(), columns);
+    _gemm(rows, columns, nb, -1.0, V.data(), nb, 1, TW.data(), columns, 1,
+          1.0, C, ldc);
+}
+
+/**
+ * @brief B = Q * B, or Q^T * B when transpose is set, one block at a time
+ * 
+ */
+void HouseholderQR::_apply(bool transpose, MatrixView B) const {
+    if(B.rows() != (size_t)_qr.num_rows())
+        throw invalid_argument("Matrix must have same rows as factored Matrix");
+    if(B.column_stride() != 1) { // blocks are applied to contiguous rows
+        Matrix X(B);
+        _apply(transpose, X._mutable_view());
+        B = X;
+        return;
+    }
+    const size_t k = _tau.size(), ldb = B.row_stride();
+    MATRIX_OP("qr_apply", B.rows(), B.columns(),
+              (4.0 * B.rows() - 2.0 * k) * k * B.columns());
+    const size_t blocks = (k + QR_BLOCK - 1) / QR_BLOCK;
+    vector<double> V;
+    for(size_t b=0; b<blocks; ++b) { // Q^T applies H_1 first, Q applies H_k
+        size_t j0 = (transpose ? b : blocks - 1 - b) * QR_BLOCK;
+        size_t nb = min<size_t>(QR_BLOCK, k - j0);
+        _explicit_v(j0, nb, V);
+        _apply_block(j0, nb, transpose, B.data() + j0*ldb, ldb,
+                     B.columns(), V);
+    }
+}
+
+#pragma endregion // FACTORIZATION
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef MATRIX_QR_H
+#define MATRIX_QR_H
+
+#include "matrix.h"
+#include <vector>
+
+/**
+ * @brief Householder QR factorization, A = Q * R
+ * 
+ * A is m x n and k = min(m, n). R is kept in the upper triangle and the
+ * Householder vectors below the diagonal of one m x n Matrix; the reflectors
+ * are grouped in blocks as I - V * T * V^T (compact WY) so the factorization
+ * and every product with Q run through the blocked multiply. Q is never
+ * formed unless asked for: apply_q() and apply_qt() multiply by it
+ * implicitly.
+ * 
+ * Q() and R() return the thin factors (m x k and k x n) with the diagonal of
+ * R made non-negative. apply_q() and apply_qt() use the full m x m product of
+ * the reflectors, with the signs as stored in factors().
+ */
+class HouseholderQR {
+public:
+
+    /* Constructors */
+
+    HouseholderQR(const Matrix& A);
+    HouseholderQR(Matrix&& A);
+
+    /* Get functions */
+
+    bool full_rank() const;
+    const Matrix& factors() const;
+    const std::vector<double>& tau() const;
+    Matrix Q() const;
+    Matrix R() const;
+
+    /* Math functions */
+
+    void apply_q(MatrixView B) const;
+    void apply_qt(MatrixView B) const;
+    Matrix solve(const Matrix& B) const;
+
+private:
+    Matrix _qr; // R on and above the diagonal, reflectors below
+    std::vector<double> _tau; // scale of each reflector, H = I - tau*v*v^T
+    Matrix _t; // k x QR_BLOCK, T of the block starting at row j in rows j..
+    bool _fullRank = true; // false if any diagonal element of R is ~0
+
+    void _factor();
+    void _factor_panel(std::size_t j0, std::size_t nb);
+    void _explicit_v(std::size_t j0, std::size_t nb,
+                     std::vector<double>& V) const;
+    void _form_t(std::size_t j0, std::size_t nb, const std::vector<double>& V);
+    void _apply_block(std::size_t j0, std::size_t nb, bool transpose,
+                      double* C, std::size_t ldc, std::size_t columns,
+                      const std::vector<double>& V) const;
+    void _apply(bool transpose, MatrixView B) const;
+};
+
+#endif
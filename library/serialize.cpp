@@ -0,0 +1,260 @@
+#include "serialize.h"
+#include <stdexcept>
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h> // CreateFileMapping(), MapViewOfFile()
+#define MATRIX_FILE_MAPPING 1
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h> // open()
+#include <sys/mman.h> // mmap(), munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h> // close()
+#define MATRIX_FILE_MAPPING 1
+#else
+#define MATRIX_FILE_MAPPING 0 // BasicMappedMatrix throws, use load()
+#endif
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+static const char _MAGIC[8] = {'M', 'A', 'T', 'R', 'I', 'X', 'B', '\n'};
+static const uint32_t _BYTE_ORDER = 0x01020304;
+
+/**
+ * @brief maps the whole file at path read only
+ *
+ * @return start of the mapping, with its size in length
+ * @throws runtime_error if the file cannot be opened or mapped, or is too
+ *         short to be a Matrix file
+ */
+void* _map_file(const string& path, size_t& length) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        throw runtime_error("Cannot open " + path);
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size)
+       || (uint64_t)size.QuadPart < sizeof(_MatrixFileHeader)) {
+        CloseHandle(file);
+        throw runtime_error("Not a Matrix file: " + path);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+                                        nullptr);
+    CloseHandle(file); // the mapping keeps the file open
+    void* map = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                        : nullptr;
+    if(mapping)
+        CloseHandle(mapping); // the view keeps the mapping
+    if(!map)
+        throw runtime_error("Cannot map " + path);
+    length = size.QuadPart;
+    return map;
+#elif MATRIX_FILE_MAPPING
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        throw runtime_error("Cannot open " + path);
+    struct stat info;
+    if(fstat(fd, &info) != 0
+       || (size_t)info.st_size < sizeof(_MatrixFileHeader)) {
+        close(fd);
+        throw runtime_error("Not a Matrix file: " + path);
+    }
+    void* map = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if(map == MAP_FAILED)
+        throw runtime_error("Cannot map " + path);
+    length = info.st_size;
+    return map;
+#else
+    (void)length;
+    throw runtime_error("Cannot map " + path
+                        + ": not supported on this platform, use load()");
+#endif
+}
+/**
+ * @brief releases a mapping made by _map_file()
+ *
+ */
+void _unmap_file(void* map, size_t length) {
+#if defined(_WIN32)
+    (void)length;
+    UnmapViewOfFile(map);
+#elif MATRIX_FILE_MAPPING
+    munmap(map, length);
+#else
+    (void)map;
+    (void)length;
+#endif
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region FILE_HEADER
+
+/**
+ * @brief header for rows x columns elements of type, in native byte order
+ *
+ */
+_MatrixFileHeader _file_header(uint32_t type, size_t rows, size_t columns) {
+    _MatrixFileHeader header = {};
+    memcpy(header.magic, _MAGIC, sizeof(_MAGIC));
+    header.version = MATRIX_FILE_VERSION;
+    header.byte_order = _BYTE_ORDER;
+    header.type = type;
+    header.rows = rows;
+    header.columns = columns;
+    header.row_stride = columns;
+    header.data_offset = sizeof(_MatrixFileHeader);
+    return header;
+}
+
+/**
+ * @return bytes per element of type (0 if type is unknown)
+ */
+size_t _file_type_size(uint32_t type) {
+    switch(type) {
+    case _FILE_FLOAT64:
+        return sizeof(double);
+    case _FILE_FLOAT32:
+        return sizeof(float);
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief throws runtime_error unless header describes a Matrix this version
+ *        can read whose elements fit in fileSize bytes
+ *
+ * @return true when the file was saved in the other byte order
+ */
+bool _check_file_header(_MatrixFileHeader& header, uint64_t fileSize) {
+    if(memcmp(header.magic, _MAGIC, sizeof(_MAGIC)) != 0)
+        throw runtime_error("Not a Matrix file");
+    bool swapped = header.byte_order != _BYTE_ORDER;
+    if(swapped) {
+        if(header.byte_order != _byteswap(_BYTE_ORDER))
+            throw runtime_error("Matrix file has unknown byte order");
+        header.version = _byteswap(header.version);
+        header.type = _byteswap(header.type);
+        header.layout = _byteswap(header.layout);
+        header.rows = _byteswap(header.rows);
+        header.columns = _byteswap(header.columns);
+        header.row_stride = _byteswap(header.row_stride);
+        header.data_offset = _byteswap(header.data_offset);
+    }
+    if(header.version == 0 || header.version > MATRIX_FILE_VERSION)
+        throw runtime_error("Matrix file version is not supported");
+    const size_t size = _file_type_size(header.type);
+    if(!size)
+        throw runtime_error("Matrix file has unknown element type");
+    if(header.layout != 0)
+        throw runtime_error("Matrix file layout is not supported");
+    if(header.data_offset < sizeof(_MatrixFileHeader)
+       || header.data_offset % MATRIX_ALIGNMENT)
+        throw runtime_error("Matrix file is corrupt");
+    if(!header.rows || !header.columns)
+        return swapped;
+    if(header.row_stride < header.columns)
+        throw runtime_error("Matrix file is corrupt");
+    /* elements that fit between the data offset and the end of the file */
+    const uint64_t limit = (fileSize - min(fileSize, header.data_offset))
+                           / size;
+    if(header.columns > limit
+       || (header.rows - 1) > (limit - header.columns) / header.row_stride)
+        throw runtime_error("Matrix file is truncated");
+    return swapped;
+}
+
+#pragma endregion // FILE_HEADER
+/******************************************************************************/
+#pragma region MAPPED_MATRIX
+
+/**
+ * @brief Map a Matrix file saved with elements of type Scalar, read only
+ *
+ */
+template <typename Scalar>
+BasicMappedMatrix<Scalar>::BasicMappedMatrix(const string& path) {
+    _map = _map_file(path, _length);
+    try {
+        _MatrixFileHeader header;
+        memcpy(&header, _map, sizeof(header));
+        if(_check_file_header(header, _length))
+            throw runtime_error(
+                "Matrix file has foreign byte order, load() it instead");
+        if(header.type != _file_type<Scalar>())
+            throw runtime_error(
+                "Matrix file has another element type, load() it instead");
+        _rows = header.rows;
+        _columns = header.columns;
+        _ld = header.row_stride;
+        _data = reinterpret_cast<const Scalar*>(
+            static_cast<const char*>(_map) + header.data_offset);
+    } catch(...) {
+        _unmap();
+        throw;
+    }
+}
+template <typename Scalar>
+BasicMappedMatrix<Scalar>::BasicMappedMatrix(
+        BasicMappedMatrix&& other) noexcept
+        : _map(other._map), _length(other._length), _data(other._data),
+          _rows(other._rows), _columns(other._columns), _ld(other._ld) {
+    other._map = nullptr;
+    other._unmap();
+}
+template <typename Scalar>
+BasicMappedMatrix<Scalar>&
+BasicMappedMatrix<Scalar>::operator=(BasicMappedMatrix&& other) noexcept {
+    if(this != &other) {
+        _unmap();
+        swap(_map, other._map);
+        swap(_length, other._length);
+        swap(_data, other._data);
+        swap(_rows, other._rows);
+        swap(_columns, other._columns);
+        swap(_ld, other._ld);
+    }
+    return *this;
+}
+
+/**
+ * @brief Unmap the file (views of it become invalid)
+ *
+ */
+template <typename Scalar>
+BasicMappedMatrix<Scalar>::~BasicMappedMatrix() {
+    _unmap();
+}
+
+/**
+ * @brief releases the mapping and leaves an empty BasicMappedMatrix
+ *
+ */
+template <typename Scalar>
+void BasicMappedMatrix<Scalar>::_unmap() {
+    if(_map)
+        _unmap_file(_map, _length);
+    _map = nullptr;
+    _length = 0;
+    _data = nullptr;
+    _rows = _columns = _ld = 0;
+}
+
+#pragma endregion // MAPPED_MATRIX
+/******************************************************************************/
+#pragma region EXPLICIT_INSTANTIATIONS
+
+template class BasicMappedMatrix<double>;
+template class BasicMappedMatrix<float>;
+
+#pragma endregion // EXPLICIT_INSTANTIATIONS
@@ -0,0 +1,163 @@
+#pragma once
+#ifndef MATRIX_SERIALIZE_H
+#define MATRIX_SERIALIZE_H
+
+#include "matrix.h"
+#include <algorithm> // reverse()
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcpy()
+#include <string>
+#include <type_traits>
+
+/*
+ * Binary Matrix files
+ *
+ * BasicMatrix::save() writes a 64 byte header followed by the elements, row
+ * after row, as raw bytes of the element type in the byte order of the
+ * machine that saved them:
+ *
+ *     offset  size  field
+ *          0     8  magic "MATRIXB\n"
+ *          8     4  version (MATRIX_FILE_VERSION)
+ *         12     4  byte order mark 0x01020304
+ *         16     4  element type (_MatrixFileType)
+ *         20     4  layout (0 = row-major)
+ *         24     8  rows
+ *         32     8  columns
+ *         40     8  elements between the starts of consecutive rows
+ *         48     8  byte offset of the first element (multiple of 64)
+ *         56     8  reserved (zero)
+ *
+ * BasicMatrix::load() reads any such file, converting the element type and
+ * byte order when they differ from the Matrix. BasicMappedMatrix maps a file
+ * read only and reads its elements in place, so opening it costs the same
+ * for any size and processes mapping one file share its pages.
+ */
+
+#define MATRIX_FILE_VERSION 1
+
+/**
+ * @brief element type codes in Matrix files
+ *
+ */
+enum _MatrixFileType : std::uint32_t {
+    _FILE_FLOAT64 = 1,
+    _FILE_FLOAT32 = 2
+};
+
+/**
+ * @brief header at the start of every Matrix file (see above)
+ *
+ */
+struct _MatrixFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t type;
+    std::uint32_t layout;
+    std::uint64_t rows;
+    std::uint64_t columns;
+    std::uint64_t row_stride;
+    std::uint64_t data_offset;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(_MatrixFileHeader) == 64,
+              "Matrix file header must be 64 bytes");
+
+/**
+ * @return element type code of Scalar
+ */
+template <typename Scalar>
+constexpr std::uint32_t _file_type() {
+    static_assert(std::is_same<Scalar, double>::value
+                  || std::is_same<Scalar, float>::value,
+                  "Matrix files hold double or float elements");
+    return std::is_same<Scalar, double>::value ? _FILE_FLOAT64 : _FILE_FLOAT32;
+}
+/**
+ * @return value with its bytes in reverse order
+ */
+template <typename T>
+inline T _byteswap(T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+/**
+ * @return header for a rows x columns Matrix of the given element type,
+ *         stored without padding right after the header
+ */
+_MatrixFileHeader _file_header(std::uint32_t type, std::size_t rows,
+                               std::size_t columns);
+/**
+ * @brief checks a header read from a file of fileSize bytes, converting its
+ *        fields to native byte order
+ *
+ * @return true when the elements are stored in the other byte order
+ */
+bool _check_file_header(_MatrixFileHeader& header, std::uint64_t fileSize);
+/**
+ * @return bytes per element of a Matrix file element type
+ */
+std::size_t _file_type_size(std::uint32_t type);
+
+/**
+ * @brief Read only Matrix backed by a memory mapped Matrix file
+ *
+ * Opening maps the file without reading it: the operating system pages
+ * elements in on first access and keeps them in the page cache, shared with
+ * every other process mapping the same file. view() reads the elements in
+ * place and can be sliced, multiplied and used in expressions like any
+ * other read only view; copy it into a BasicMatrix to modify it. The file
+ * must hold elements of type Scalar in native byte order (use
+ * BasicMatrix::load() to convert), and views must not outlive the mapping.
+ * Files are mapped with mmap() on POSIX systems and MapViewOfFile() on
+ * Windows; elsewhere the constructor throws and load() must be used.
+ */
+template <typename Scalar>
+class BasicMappedMatrix {
+public:
+
+    /* Constructors */
+
+    BasicMappedMatrix() = default;
+    explicit BasicMappedMatrix(const std::string& path);
+    BasicMappedMatrix(BasicMappedMatrix&& other) noexcept;
+    BasicMappedMatrix& operator=(BasicMappedMatrix&& other) noexcept;
+    BasicMappedMatrix(const BasicMappedMatrix&) = delete;
+    void operator=(const BasicMappedMatrix&) = delete;
+    ~BasicMappedMatrix();
+
+    /* Get functions */
+
+    std::size_t num_rows() const { return _rows; }
+    std::size_t num_columns() const { return _columns; }
+    bool empty() const { return !(_rows && _columns); }
+    const Scalar* data() const { return _data; }
+    std::size_t leading_dim() const { return _ld; }
+    const Scalar& operator()(std::size_t row, std::size_t col) const {
+        return _data[row * _ld + col];
+    }
+    BasicMatrixView<const Scalar> view() const {
+        return BasicMatrixView<const Scalar>(_data, _rows, _columns, _ld);
+    }
+
+private:
+    void* _map = nullptr; // start of the mapping
+    std::size_t _length = 0; // bytes mapped
+    const Scalar* _data = nullptr; // first element, inside the mapping
+    std::size_t _rows = 0;
+    std::size_t _columns = 0;
+    std::size_t _ld = 0; // elements between rows
+
+    void _unmap();
+};
+
+typedef BasicMappedMatrix<double> MappedMatrix;
+typedef BasicMappedMatrix<float> MappedMatrixF;
+
+#endif
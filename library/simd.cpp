@@ -0,0 +1,262 @@
+#include "kernels.h"
+#include <cstdlib> // getenv()
+#include <cstring> // memcpy(), strcmp()
+
+using namespace std;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1 // SSE2, AVX2 and AVX-512 kernels are built
+#else
+#define SIMD_X86 0 // portable scalar kernels only
+#endif
+
+#pragma region PRIVATE_FUNCTONS
+
+/* Scalar kernels (any CPU) */
+
+/**
+ * @return sum of x[i*incx] * y[i*incy], four independent partial sums
+ */
+template <typename T>
+T _dot_scalar(size_t n, const T* x, size_t incx, const T* y, size_t incy) {
+    T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i = 0;
+    for(; i+4<=n; i+=4) {
+        s0 += x[i*incx] * y[i*incy];
+        s1 += x[(i+1)*incx] * y[(i+1)*incy];
+        s2 += x[(i+2)*incx] * y[(i+2)*incy];
+        s3 += x[(i+3)*incx] * y[(i+3)*incy];
+    }
+    for(; i<n; ++i)
+        s0 += x[i*incx] * y[i*incy];
+    return (s0 + s1) + (s2 + s3);
+}
+/**
+ * @brief z = y + alpha * x
+ * 
+ */
+template <typename T>
+void _axpy_scalar(size_t n, T alpha, const T* x, const T* y, T* z) {
+    for(size_t i=0; i<n; ++i)
+        z[i] = y[i] + alpha * x[i];
+}
+/**
+ * @brief z = alpha * x
+ * 
+ */
+template <typename T>
+void _scale_scalar(size_t n, T alpha, const T* x, T* z) {
+    for(size_t i=0; i<n; ++i)
+        z[i] = alpha * x[i];
+}
+
+#if SIMD_X86
+
+/* Vector kernel bodies, BYTES wide. They are only ever inlined into the
+   target specific wrappers below, which decide the instructions used. */
+
+/**
+ * @return sum of x[i] * y[i] over four vector accumulators
+ */
+template <size_t BYTES, typename T>
+__attribute__((always_inline))
+inline T _dot_body(size_t n, const T* x, const T* y) {
+    typedef T V __attribute__((vector_size(BYTES)));
+    constexpr size_t W = BYTES / sizeof(T);
+    V acc0 = {}, acc1 = {}, acc2 = {}, acc3 = {};
+    size_t i = 0;
+    for(; i+4*W<=n; i+=4*W) {
+        V a0, a1, a2, a3, b0, b1, b2, b3;
+        memcpy(&a0, x + i, sizeof(V));
+        memcpy(&a1, x + i + W, sizeof(V));
+        memcpy(&a2, x + i + 2*W, sizeof(V));
+        memcpy(&a3, x + i + 3*W, sizeof(V));
+        memcpy(&b0, y + i, sizeof(V));
+        memcpy(&b1, y + i + W, sizeof(V));
+        memcpy(&b2, y + i + 2*W, sizeof(V));
+        memcpy(&b3, y + i + 3*W, sizeof(V));
+        acc0 += a0 * b0;
+        acc1 += a1 * b1;
+        acc2 += a2 * b2;
+        acc3 += a3 * b3;
+    }
+    for(; i+W<=n; i+=W) {
+        V a, b;
+        memcpy(&a, x + i, sizeof(V));
+        memcpy(&b, y + i, sizeof(V));
+        acc0 += a * b;
+    }
+    V acc = (acc0 + acc1) + (acc2 + acc3);
+    T sum = 0;
+    for(size_t l=0; l<W; ++l)
+        sum += acc[l];
+    for(; i<n; ++i)
+        sum += x[i] * y[i];
+    return sum;
+}
+/**
+ * @brief z = y + alpha * x, BYTES at a time
+ * 
+ */
+template <size_t BYTES, typename T>
+__attribute__((always_inline))
+inline void _axpy_body(size_t n, T alpha, const T* x, const T* y, T* z) {
+    typedef T V __attribute__((vector_size(BYTES)));
+    constexpr size_t W = BYTES / sizeof(T);
+    size_t i = 0;
+    for(; i+W<=n; i+=W) {
+        V a, b;
+        memcpy(&a, x + i, sizeof(V));
+        memcpy(&b, y + i, sizeof(V));
+        b += alpha * a;
+        memcpy(z + i, &b, sizeof(V));
+    }
+    for(; i<n; ++i)
+        z[i] = y[i] + alpha * x[i];
+}
+/**
+ * @brief z = alpha * x, BYTES at a time
+ * 
+ */
+template <size_t BYTES, typename T>
+__attribute__((always_inline))
+inline void _scale_body(size_t n, T alpha, const T* x, T* z) {
+    typedef T V __attribute__((vector_size(BYTES)));
+    constexpr size_t W = BYTES / sizeof(T);
+    size_t i = 0;
+    for(; i+W<=n; i+=W) {
+        V a;
+        memcpy(&a, x + i, sizeof(V));
+        a *= alpha;
+        memcpy(z + i, &a, sizeof(V));
+    }
+    for(; i<n; ++i)
+        z[i] = alpha * x[i];
+}
+
+/* One set of kernels per instruction set */
+
+#define SIMD_DEFINE_KERNELS(ISA, TARGET, BYTES) \
+template <typename T> __attribute__((target(TARGET))) \
+T _dot_##ISA(size_t n, const T* x, size_t incx, const T* y, size_t incy) { \
+    if(incx != 1 || incy != 1) \
+        return _dot_scalar(n, x, incx, y, incy); \
+    return _dot_body<BYTES>(n, x, y); \
+} \
+template <typename T> __attribute__((target(TARGET))) \
+void _axpy_##ISA(size_t n, T alpha, const T* x, const T* y, T* z) { \
+    _axpy_body<BYTES>(n, alpha, x, y, z); \
+} \
+template <typename T> __attribute__((target(TARGET))) \
+void _scale_##ISA(size_t n, T alpha, const T* x, T* z) { \
+    _scale_body<BYTES>(n, alpha, x, z); \
+}
+
+SIMD_DEFINE_KERNELS(sse2, "sse2", 16)
+SIMD_DEFINE_KERNELS(avx2, "avx2", 32)
+SIMD_DEFINE_KERNELS(avx512, "avx512f", 64)
+
+#endif // SIMD_X86
+
+/**
+ * @brief kernels chosen for this CPU, for element type T
+ * 
+ */
+template <typename T>
+struct _SimdTable {
+    T (*dot)(size_t, const T*, size_t, const T*, size_t);
+    void (*axpy)(size_t, T, const T*, const T*, T*);
+    void (*scale)(size_t, T, const T*, T*);
+};
+
+/**
+ * @brief widest instruction set supported by the CPU, capped by
+ *        MATRIX_SIMD (scalar, sse2, avx2 or avx512) when it is set
+ * 
+ */
+_SimdLevel _detect_simd() {
+    _SimdLevel level = _SimdLevel::scalar;
+#if SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2"))
+        level = _SimdLevel::sse2;
+    if(__builtin_cpu_supports("avx2"))
+        level = _SimdLevel::avx2;
+    if(__builtin_cpu_supports("avx512f"))
+        level = _SimdLevel::avx512;
+#endif
+    if(const char* env = getenv("MATRIX_SIMD")) {
+        _SimdLevel cap = level;
+        if(!strcmp(env, "scalar"))
+            cap = _SimdLevel::scalar;
+        else if(!strcmp(env, "sse2"))
+            cap = _SimdLevel::sse2;
+        else if(!strcmp(env, "avx2"))
+            cap = _SimdLevel::avx2;
+        if(cap < level)
+            level = cap;
+    }
+    return level;
+}
+
+/**
+ * @return kernel table for T, selected on first use
+ */
+template <typename T>
+const _SimdTable<T>& _simd() {
+    static const _SimdTable<T> table = [] {
+        switch(_simd_level()) {
+#if SIMD_X86
+        case _SimdLevel::avx512:
+            return _SimdTable<T>{_dot_avx512<T>, _axpy_avx512<T>,
+                                 _scale_avx512<T>};
+        case _SimdLevel::avx2:
+            return _SimdTable<T>{_dot_avx2<T>, _axpy_avx2<T>, _scale_avx2<T>};
+        case _SimdLevel::sse2:
+            return _SimdTable<T>{_dot_sse2<T>, _axpy_sse2<T>, _scale_sse2<T>};
+#endif
+        default:
+            return _SimdTable<T>{_dot_scalar<T>, _axpy_scalar<T>,
+                                 _scale_scalar<T>};
+        }
+    }();
+    return table;
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region SIMD
+
+/**
+ * @return instruction set used by the vector kernels (fixed on first call)
+ */
+_SimdLevel _simd_level() {
+    static const _SimdLevel level = _detect_simd();
+    return level;
+}
+
+template <typename T>
+T _simd_dot(size_t n, const T* x, size_t incx, const T* y, size_t incy) {
+    return _simd<T>().dot(n, x, incx, y, incy);
+}
+template <typename T>
+void _simd_axpy(size_t n, T alpha, const T* x, const T* y, T* z) {
+    _simd<T>().axpy(n, alpha, x, y, z);
+}
+template <typename T>
+void _simd_scale(size_t n, T alpha, const T* x, T* z) {
+    _simd<T>().scale(n, alpha, x, z);
+}
+
+template double _simd_dot(size_t n, const double* x, size_t incx,
+                          const double* y, size_t incy);
+template float _simd_dot(size_t n, const float* x, size_t incx,
+                         const float* y, size_t incy);
+template void _simd_axpy(size_t n, double alpha, const double* x,
+                         const double* y, double* z);
+template void _simd_axpy(size_t n, float alpha, const float* x,
+                         const float* y, float* z);
+template void _simd_scale(size_t n, double alpha, const double* x, double* z);
+template void _simd_scale(size_t n, float alpha, const float* x, float* z);
+
+#pragma endregion // SIMD
@@ -0,0 +1,343 @@
+#include "sparse.h"
+#include "thread_pool.h"
+#include <stdexcept>
+#include <algorithm>
+#include <numeric> // partial_sum()
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief runs func(lo, hi) over row ranges covering every row, spread over
+ *        the thread pool so each task averages PARALLEL_MIN_WORK nonzeros
+ * 
+ */
+template <typename F>
+void SparseMatrix::_for_rows(F func) const {
+    size_t grain = max<size_t>(1, PARALLEL_MIN_WORK * _rows
+                                  / max<size_t>(nonzeros(), 1));
+    if(_rows <= grain)
+        func(size_t(0), _rows);
+    else
+        ThreadPool::instance().parallel_for(0, _rows, grain, func);
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region CONSTRUCTORS
+
+/**
+ * @brief Construct empty SparseMatrix
+ * 
+ */
+SparseMatrix::SparseMatrix() : _rowStart(1, 0) {}
+
+/**
+ * @brief Construct SparseMatrix of given size with all zeros
+ * 
+ */
+SparseMatrix::SparseMatrix(size_t rows, size_t columns)
+        : _rows(rows), _columns(columns), _rowStart(rows + 1, 0) {}
+
+/**
+ * @brief Construct SparseMatrix from (row, column, value) entries in any
+ *        order; values of repeated positions are added together
+ * 
+ */
+SparseMatrix::SparseMatrix(size_t rows, size_t columns,
+                           const vector<Triplet>& entries)
+        : SparseMatrix(rows, columns) {
+    for(const Triplet& entry : entries) {
+        if(entry.row >= rows)
+            throw out_of_range("Row does not exist");
+        if(entry.column >= columns)
+            throw out_of_range("Column does not exist");
+        ++_rowStart[entry.row + 1];
+    }
+    partial_sum(_rowStart.begin(), _rowStart.end(), _rowStart.begin());
+    _colIndex.resize(entries.size());
+    _values.resize(entries.size());
+    vector<size_t> next(_rowStart.begin(), _rowStart.end() - 1);
+    for(const Triplet& entry : entries) { // bucket by row
+        size_t pos = next[entry.row]++;
+        _colIndex[pos] = entry.column;
+        _values[pos] = entry.value;
+    }
+    size_t out = 0;
+    vector<size_t> order;
+    vector<size_t> colIndex(entries.size());
+    vector<double> values(entries.size());
+    for(size_t i=0; i<rows; ++i) { // sort each row, merge duplicates
+        size_t begin = _rowStart[i], end = _rowStart[i + 1];
+        order.resize(end - begin);
+        iota(order.begin(), order.end(), begin);
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return _colIndex[a] < _colIndex[b];
+        });
+        _rowStart[i] = out;
+        for(size_t k=0; k<order.size(); ++k) {
+            if(k && _colIndex[order[k]] == colIndex[out - 1]) {
+                values[out - 1] += _values[order[k]];
+                continue;
+            }
+            colIndex[out] = _colIndex[order[k]];
+            values[out++] = _values[order[k]];
+        }
+    }
+    _rowStart[rows] = out;
+    colIndex.resize(out);
+    values.resize(out);
+    _colIndex = move(colIndex);
+    _values = move(values);
+}
+
+/**
+ * @brief Construct SparseMatrix from the nonzero elements of a Matrix
+ * 
+ */
+SparseMatrix::SparseMatrix(const Matrix& dense)
+        : SparseMatrix(dense.num_rows(), dense.num_columns()) {
+    for(size_t i=0; i<_rows; ++i) {
+        for(size_t j=0; j<_columns; ++j) {
+            if(dense(i, j) != 0) {
+                _colIndex.push_back(j);
+                _values.push_back(dense(i, j));
+            }
+        }
+        _rowStart[i + 1] = _colIndex.size();
+    }
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region GET_FUNCTIONS
+
+/**
+ * @return number of rows
+ */
+size_t SparseMatrix::num_rows() const {
+    return _rows;
+}
+/**
+ * @return number of columns
+ */
+size_t SparseMatrix::num_columns() const {
+    return _columns;
+}
+/**
+ * @return number of stored elements
+ */
+size_t SparseMatrix::nonzeros() const {
+    return _values.size();
+}
+/**
+ * @return true if SparseMatrix has no rows or columns
+ */
+bool SparseMatrix::empty() const {
+    return !_rows || !_columns;
+}
+
+/**
+ * @brief returns element at given row and column (0 if not stored)
+ * 
+ */
+double SparseMatrix::at(size_t row, size_t col) const {
+    if(row >= _rows)
+        throw out_of_range("Row does not exist");
+    if(col >= _columns)
+        throw out_of_range("Column does not exist");
+    auto begin = _colIndex.begin() + _rowStart[row];
+    auto end = _colIndex.begin() + _rowStart[row + 1];
+    auto found = lower_bound(begin, end, col);
+    if(found == end || *found != col)
+        return 0;
+    return _values[found - _colIndex.begin()];
+}
+
+/**
+ * @return offset of the first nonzero of each row (plus one past the end)
+ */
+const vector<size_t>& SparseMatrix::row_start() const {
+    return _rowStart;
+}
+/**
+ * @return column of each nonzero
+ */
+const vector<size_t>& SparseMatrix::column_index() const {
+    return _colIndex;
+}
+/**
+ * @return value of each nonzero
+ */
+const vector<double>& SparseMatrix::values() const {
+    return _values;
+}
+
+/**
+ * @brief returns dense copy (size limits of Matrix apply)
+ * 
+ */
+Matrix SparseMatrix::to_dense() const {
+    if(empty())
+        return Matrix();
+    Matrix dense(_rows, _columns);
+    double* d = dense._mutable_data();
+    const size_t ld = dense.leading_dim();
+    for(size_t i=0; i<_rows; ++i)
+        for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k)
+            d[i*ld + _colIndex[k]] = _values[k];
+    return dense;
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region MATH_FUNCTIONS
+
+/**
+ * @brief multiply SparseMatrix with vector
+ * 
+ */
+vector<double> SparseMatrix::operator*(const vector<double>& vec) const {
+    if(_columns != vec.size())
+        throw invalid_argument("Vector must be same size as number of columns");
+    vector<double> product(_rows);
+    _for_rows([&](size_t lo, size_t hi) {
+        for(size_t i=lo; i<hi; ++i) {
+            double sum = 0;
+            for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k)
+                sum += _values[k] * vec[_colIndex[k]];
+            product[i] = sum;
+        }
+    });
+    return product;
+}
+
+/**
+ * @brief multiply SparseMatrix with dense Matrix
+ * 
+ */
+Matrix SparseMatrix::operator*(const Matrix& dense) const {
+    if(empty() || dense.empty())
+        throw domain_error("Matricies must have data");
+    if(_columns != (size_t)dense.num_rows())
+        throw invalid_argument
+            ("Invalid Matrix dimentions for multiplication");
+    const size_t n = dense.num_columns(), ldd = dense.leading_dim();
+    Matrix product(_rows, n);
+    double* p = product._mutable_data();
+    const size_t ldp = product.leading_dim();
+    _for_rows([&](size_t lo, size_t hi) {
+        for(size_t i=lo; i<hi; ++i) {
+            double* out = p + i*ldp;
+            for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k) {
+                const double value = _values[k];
+                const double* row = dense.data() + _colIndex[k]*ldd;
+                for(size_t j=0; j<n; ++j)
+                    out[j] += value * row[j];
+            }
+        }
+    });
+    return product;
+}
+
+/**
+ * @brief multiply SparseMatrix objects (row by row Gustavson product)
+ * 
+ * A first pass counts the nonzeros of every product row so the second pass
+ * can fill each row in place; both passes run in parallel.
+ */
+SparseMatrix SparseMatrix::operator*(const SparseMatrix& other) const {
+    if(_columns != other._rows)
+        throw invalid_argument
+            ("Invalid Matrix dimentions for multiplication");
+    SparseMatrix product(_rows, other._columns);
+    // per thread scratch indexed by column, cleared again after every row
+    auto count = [&](size_t lo, size_t hi) {
+        thread_local vector<char> seen;
+        thread_local vector<size_t> touched;
+        if(seen.size() < other._columns)
+            seen.resize(other._columns, 0);
+        for(size_t i=lo; i<hi; ++i) {
+            touched.clear();
+            for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k) {
+                size_t r = _colIndex[k];
+                for(size_t q=other._rowStart[r]; q<other._rowStart[r + 1];
+                    ++q) {
+                    size_t j = other._colIndex[q];
+                    if(!seen[j]) {
+                        seen[j] = 1;
+                        touched.push_back(j);
+                    }
+                }
+            }
+            product._rowStart[i + 1] = touched.size();
+            for(size_t j : touched)
+                seen[j] = 0;
+        }
+    };
+    _for_rows(count);
+    partial_sum(product._rowStart.begin(), product._rowStart.end(),
+                product._rowStart.begin());
+    product._colIndex.resize(product._rowStart[_rows]);
+    product._values.resize(product._rowStart[_rows]);
+
+    auto fill = [&](size_t lo, size_t hi) {
+        thread_local vector<char> seen;
+        thread_local vector<double> sums;
+        if(seen.size() < other._columns) {
+            seen.resize(other._columns, 0);
+            sums.resize(other._columns, 0);
+        }
+        for(size_t i=lo; i<hi; ++i) {
+            size_t* columns = product._colIndex.data() + product._rowStart[i];
+            size_t found = 0;
+            for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k) {
+                const size_t r = _colIndex[k];
+                const double value = _values[k];
+                for(size_t q=other._rowStart[r]; q<other._rowStart[r + 1];
+                    ++q) {
+                    size_t j = other._colIndex[q];
+                    if(!seen[j]) {
+                        seen[j] = 1;
+                        columns[found++] = j;
+                    }
+                    sums[j] += value * other._values[q];
+                }
+            }
+            sort(columns, columns + found);
+            double* values = product._values.data() + product._rowStart[i];
+            for(size_t p=0; p<found; ++p) {
+                values[p] = sums[columns[p]];
+                sums[columns[p]] = 0;
+                seen[columns[p]] = 0;
+            }
+        }
+    };
+    _for_rows(fill);
+    return product;
+}
+
+/**
+ * @brief returns transpose of SparseMatrix (counting sort by column)
+ * 
+ */
+SparseMatrix SparseMatrix::transpose() const {
+    SparseMatrix T(_columns, _rows);
+    for(size_t col : _colIndex)
+        ++T._rowStart[col + 1];
+    partial_sum(T._rowStart.begin(), T._rowStart.end(), T._rowStart.begin());
+    T._colIndex.resize(nonzeros());
+    T._values.resize(nonzeros());
+    vector<size_t> next(T._rowStart.begin(), T._rowStart.end() - 1);
+    for(size_t i=0; i<_rows; ++i) { // rows in order keep columns of T sorted
+        for(size_t k=_rowStart[i]; k<_rowStart[i + 1]; ++k) {
+            size_t pos = next[_colIndex[k]]++;
+            T._colIndex[pos] = i;
+            T._values[pos] = _values[k];
+        }
+    }
+    return T;
+}
+
+#pragma endregion // MATH_FUNCTIONS
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef MATRIX_SPARSE_H
+#define MATRIX_SPARSE_H
+
+#include "matrix.h"
+#include <vector>
+
+/**
+ * @brief Sparse Matrix in compressed sparse row (CSR) form
+ * 
+ * Only nonzero elements are stored: their values and column indexes row by
+ * row (sorted by column), plus the offset where each row starts. Memory is
+ * O(rows + nonzeros), so dimensions are not capped by MAX_MATRIX_SIZE.
+ * transpose() of a CSR Matrix is the compressed sparse column (CSC) form of
+ * the original.
+ * 
+ * Products with vectors, dense Matrix objects and other sparse matrices run
+ * on the shared thread pool, split by rows.
+ */
+class SparseMatrix {
+public:
+
+    /**
+     * @brief One element for building a SparseMatrix
+     * 
+     */
+    struct Triplet {
+        std::size_t row;
+        std::size_t column;
+        double value;
+    };
+
+    /* Constructors */
+
+    SparseMatrix();
+    SparseMatrix(std::size_t rows, std::size_t columns);
+    SparseMatrix(std::size_t rows, std::size_t columns,
+                 const std::vector<Triplet>& entries);
+    explicit SparseMatrix(const Matrix& dense);
+
+    /* Get functions */
+
+    std::size_t num_rows() const;
+    std::size_t num_columns() const;
+    std::size_t nonzeros() const;
+    bool empty() const;
+    double at(std::size_t row, std::size_t col) const;
+    const std::vector<std::size_t>& row_start() const;
+    const std::vector<std::size_t>& column_index() const;
+    const std::vector<double>& values() const;
+    Matrix to_dense() const;
+
+    /* Math functions */
+
+    std::vector<double> operator*(const std::vector<double>& vec) const;
+    Matrix operator*(const Matrix& dense) const;
+    SparseMatrix operator*(const SparseMatrix& other) const;
+    SparseMatrix transpose() const;
+
+private:
+    std::size_t _rows = 0;
+    std::size_t _columns = 0;
+    std::vector<std::size_t> _rowStart; // rows + 1 offsets into _colIndex
+    std::vector<std::size_t> _colIndex; // column of each nonzero
+    std::vector<double> _values; // value of each nonzero
+
+    template <typename F>
+    void _for_rows(F func) const;
+};
+
+#endif
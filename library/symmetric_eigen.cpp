@@ -0,0 +1,465 @@
+#include "symmetric_eigen.h"
+#include "kernels.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric> // iota()
+#include <random>
+
+using namespace std;
+
+#define QL_MAX_ITERATIONS 60 // QL sweeps allowed per eigenvalue
+#define INVERSE_ITERATIONS 3 // solves per eigenvector of a subset
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief eigenvalues of the symmetric tridiagonal Matrix with diagonal d and
+ *        subdiagonal e (e[n-1] == 0) by implicit QL with Wilkinson shifts;
+ *        d is overwritten with the (unsorted) eigenvalues and e destroyed
+ * 
+ * When Zt is given every rotation is also applied to its rows, so starting
+ * from Q^T it ends with one eigenvector per row.
+ * 
+ * @return false if an eigenvalue did not converge
+ */
+bool _tridiagonal_ql(size_t n, double* d, double* e, double* Zt, size_t ldz) {
+    const double eps = numeric_limits<double>::epsilon();
+    double shift = 0, largest = 0;
+    for(size_t l=0; l<n; ++l) {
+        largest = max(largest, fabs(d[l]) + fabs(e[l]));
+        size_t m = l; // first negligible subdiagonal at or after l
+        while(fabs(e[m]) > eps * largest)
+            ++m;
+        int iter = 0;
+        while(m > l) {
+            if(++iter > QL_MAX_ITERATIONS)
+                return false;
+            double g = d[l];
+            double p = (d[l+1] - g) / (2 * e[l]);
+            double r = hypot(p, 1.0);
+            if(p < 0)
+                r = -r;
+            d[l] = e[l] / (p + r);
+            d[l+1] = e[l] * (p + r);
+            double dl1 = d[l+1], h = g - d[l];
+            for(size_t i=l+2; i<n; ++i)
+                d[i] -= h;
+            shift += h;
+
+            p = d[m];
+            double c = 1, c2 = 1, c3 = 1, el1 = e[l+1], s = 0, s2 = 0;
+            for(size_t i=m; i-- > l;) { // rotations from the bottom up
+                c3 = c2;
+                c2 = c;
+                s2 = s;
+                g = c * e[i];
+                h = c * p;
+                r = hypot(p, e[i]);
+                e[i+1] = s * r;
+                s = e[i] / r;
+                c = p / r;
+                p = c * d[i] - s * g;
+                d[i+1] = h + s * (c * g + s * d[i]);
+                if(Zt) {
+                    double* zi = Zt + i*ldz;
+                    double* zi1 = Zt + (i+1)*ldz;
+                    for(size_t k=0; k<n; ++k) {
+                        h = zi1[k];
+                        zi1[k] = s * zi[k] + c * h;
+                        zi[k] = c * zi[k] - s * h;
+                    }
+                }
+            }
+            p = -s * s2 * c3 * el1 * e[l] / dl1;
+            e[l] = s * p;
+            d[l] = c * p;
+            if(fabs(e[l]) <= eps * largest)
+                break;
+        }
+        d[l] += shift;
+        e[l] = 0;
+    }
+    return true;
+}
+
+/**
+ * @brief one inverse iteration step: x = (T - lambda*I)^-1 * x for the
+ *        tridiagonal T (diagonal d, subdiagonal e), by Gaussian elimination
+ *        with partial pivoting; zero pivots are replaced by pivotFloor
+ * 
+ */
+void _tridiagonal_shifted_solve(size_t n, const double* d, const double* e,
+                                double lambda, double pivotFloor,
+                                double* x, vector<double>& work) {
+    work.resize(4*n);
+    double* diag = work.data(); // U diagonal
+    double* up = diag + n; // U first superdiagonal
+    double* up2 = up + n; // U second superdiagonal (from row swaps)
+    double* low = up2 + n; // multipliers (row swapped if up2 set)
+    for(size_t i=0; i<n; ++i) {
+        diag[i] = d[i] - lambda;
+        up[i] = i+1 < n ? e[i] : 0;
+        up2[i] = 0;
+    }
+    vector<bool> swapped(n, false);
+    for(size_t i=0; i+1<n; ++i) {
+        if(fabs(diag[i]) >= fabs(e[i])) {
+            if(diag[i] == 0)
+                diag[i] = pivotFloor;
+            low[i] = e[i] / diag[i];
+            diag[i+1] -= low[i] * up[i];
+        } else { // swap rows i and i+1
+            swapped[i] = true;
+            double fact = diag[i] / e[i];
+            diag[i] = e[i];
+            low[i] = fact;
+            double tmp = up[i];
+            up[i] = diag[i+1];
+            diag[i+1] = tmp - fact * diag[i+1];
+            if(i+2 < n) {
+                up2[i] = up[i+1];
+                up[i+1] = -fact * up[i+1];
+            }
+        }
+    }
+    if(diag[n-1] == 0)
+        diag[n-1] = pivotFloor;
+    for(size_t i=0; i+1<n; ++i) { // forward with L
+        if(swapped[i]) {
+            double tmp = x[i];
+            x[i] = x[i+1];
+            x[i+1] = tmp - low[i] * x[i];
+        } else {
+            x[i+1] -= low[i] * x[i];
+        }
+    }
+    for(size_t i=n; i-- > 0;) { // back with U
+        double sum = x[i];
+        if(i+1 < n)
+            sum -= up[i] * x[i+1];
+        if(i+2 < n)
+            sum -= up2[i] * x[i+2];
+        x[i] = sum / diag[i];
+    }
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region CONSTRUCTORS
+
+/**
+ * @brief Find all eigenvalues (and eigenvectors) of a symmetric Matrix
+ * 
+ * @param A symmetric Matrix (only the lower triangle is read)
+ * @param vectors weither to compute eigenvectors
+ */
+SymmetricEigen::SymmetricEigen(const Matrix& A, bool vectors)
+        : SymmetricEigen(A, _Reduce()) {
+    const size_t n = _diag.size();
+    vector<double> e(_sub);
+    _values = _diag;
+    if(!vectors) {
+        _a = Matrix();
+        if(!_tridiagonal_ql(n, _values.data(), e.data(), nullptr, 0))
+            throw runtime_error("Could not find values");
+        sort(_values.begin(), _values.end());
+        return;
+    }
+    // QL rotates rows, so eigenvectors are found as the rows of Zt = Q^T
+    Matrix Zt(n);
+    _form_qt(Zt);
+    _a = Matrix(); // reflectors are no longer needed
+    if(!_tridiagonal_ql(n, _values.data(), e.data(), Zt._mutable_data(),
+                        Zt.leading_dim()))
+        throw runtime_error("Could not find values");
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(),
+         [&](size_t a, size_t b) { return _values[a] < _values[b]; });
+    // sort the rows in place (at[i] is the QL row now in row i), then
+    // transpose them into columns
+    vector<size_t> at(order), where(n);
+    iota(at.begin(), at.end(), 0);
+    iota(where.begin(), where.end(), 0);
+    vector<double> sorted(n);
+    for(size_t j=0; j<n; ++j) {
+        sorted[j] = _values[order[j]];
+        const size_t i = where[order[j]];
+        if(i != j) {
+            Zt.swap_row(i, j);
+            swap(at[i], at[j]);
+            where[at[i]] = i;
+            where[at[j]] = j;
+        }
+    }
+    Zt.transpose_in_place();
+    _vectors = move(Zt);
+    _values = move(sorted);
+}
+
+/**
+ * @brief Find eigenvalues first through last (ascending order, inclusive)
+ *        of a symmetric Matrix
+ * 
+ * @param A symmetric Matrix (only the lower triangle is read)
+ * @param vectors weither to compute eigenvectors
+ */
+SymmetricEigen SymmetricEigen::by_index(const Matrix& A, size_t first,
+                                        size_t last, bool vectors) {
+    SymmetricEigen result(A, _Reduce());
+    if(first > last || last >= result._diag.size())
+        throw out_of_range("Eigenvalue index does not exist");
+    result._select(result._tridiagonal_values(), first, last - first + 1,
+                   vectors);
+    return result;
+}
+/**
+ * @brief Find eigenvalues in [low, high] of a symmetric Matrix
+ * 
+ * @param A symmetric Matrix (only the lower triangle is read)
+ * @param vectors weither to compute eigenvectors
+ */
+SymmetricEigen SymmetricEigen::by_value(const Matrix& A, double low,
+                                        double high, bool vectors) {
+    SymmetricEigen result(A, _Reduce());
+    vector<double> all = result._tridiagonal_values();
+    size_t first = lower_bound(all.begin(), all.end(), low) - all.begin();
+    size_t end = upper_bound(all.begin(), all.end(), high) - all.begin();
+    result._select(all, first, end > first ? end - first : 0, vectors);
+    return result;
+}
+
+/**
+ * @brief checks A and reduces a copy of it to tridiagonal form
+ * 
+ */
+SymmetricEigen::SymmetricEigen(const Matrix& A, _Reduce) : _a(A) {
+    if(_a.empty())
+        throw invalid_argument("Matrix must have data");
+    if(_a.num_rows() != _a.num_columns())
+        throw invalid_argument("Matrix must be square");
+    _tridiagonalize();
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region GET_FUNCTIONS
+
+/**
+ * @return eigenvalues in ascending order
+ */
+const vector<double>& SymmetricEigen::values() const {
+    return _values;
+}
+
+/**
+ * @return unit eigenvectors as columns, matching values() (empty if not
+ *         computed)
+ */
+const Matrix& SymmetricEigen::vectors() const {
+    return _vectors;
+}
+
+#pragma endregion // GET_FUNCTIONS
+/******************************************************************************/
+#pragma region TRIDIAGONAL
+
+/**
+ * @brief Householder tridiagonalization of the lower triangle: each
+ *        reflector zeros one column below the subdiagonal and is applied to
+ *        the trailing submatrix as a symmetric rank-2 update
+ * 
+ */
+void SymmetricEigen::_tridiagonalize() {
+    const size_t n = _a.num_rows(), ld = _a.leading_dim();
+    double* a = _a._mutable_data();
+    _tau.assign(n, 0);
+    _diag.resize(n);
+    _sub.assign(n, 0);
+    vector<double> v(n), w(n);
+    for(size_t k=0; k+2<n; ++k) {
+        double alpha = a[(k+1)*ld + k], sigma = 0;
+        for(size_t i=k+2; i<n; ++i)
+            sigma += a[i*ld + k] * a[i*ld + k];
+        if(sigma == 0) // column already tridiagonal
+            continue;
+        double norm = sqrt(alpha*alpha + sigma);
+        double beta = alpha > 0 ? -norm : norm;
+        double tau = _tau[k] = (beta - alpha) / beta;
+        double scale = 1 / (alpha - beta);
+        a[(k+1)*ld + k] = beta;
+        v[k+1] = 1;
+        for(size_t i=k+2; i<n; ++i)
+            v[i] = (a[i*ld + k] *= scale);
+        // w = tau * A22 * v from the lower triangle
+        fill(w.begin() + k+1, w.end(), 0.0);
+        for(size_t i=k+1; i<n; ++i) {
+            const double* row = a + i*ld;
+            double sum = 0;
+            for(size_t j=k+1; j<i; ++j) {
+                sum += row[j] * v[j];
+                w[j] += row[j] * v[i];
+            }
+            w[i] += sum + row[i] * v[i];
+        }
+        double dot = 0;
+        for(size_t i=k+1; i<n; ++i)
+            dot += (w[i] *= tau) * v[i];
+        for(size_t i=k+1; i<n; ++i)
+            w[i] -= 0.5 * tau * dot * v[i];
+        // A22 -= v * w^T + w * v^T
+        for(size_t i=k+1; i<n; ++i) {
+            double* row = a + i*ld;
+            const double vi = v[i], wi = w[i];
+            for(size_t j=k+1; j<=i; ++j)
+                row[j] -= vi * w[j] + wi * v[j];
+        }
+    }
+    for(size_t i=0; i<n; ++i) {
+        _diag[i] = a[i*ld + i];
+        if(i+1 < n)
+            _sub[i] = a[(i+1)*ld + i];
+    }
+}
+
+/**
+ * @brief Zt = Q^T where Q is the product of the tridiagonalizing reflectors
+ *        and Zt starts as the identity, applied from the right so rows stay
+ *        contiguous: Zt = I * H(n-3) * ... * H(0), each H symmetric; rows
+ *        above k+1 are still the identity when H(k) is applied
+ * 
+ */
+void SymmetricEigen::_form_qt(Matrix& Zt) const {
+    const size_t n = _diag.size(), ldz = Zt.leading_dim();
+    if(n < 3)
+        return;
+    double* z = Zt._mutable_data();
+    vector<double> v(n);
+    for(size_t k=n-2; k-- > 0;) { // last reflector first
+        const double tau = _tau[k];
+        if(tau == 0)
+            continue;
+        v[k+1] = 1;
+        for(size_t i=k+2; i<n; ++i)
+            v[i] = _a(i, k);
+        for(size_t r=k+1; r<n; ++r) { // row -= tau * (row * v) * v^T
+            double* row = z + r*ldz + k+1;
+            const double dot = tau * _simd_dot(n-k-1, row, 1, &v[k+1], 1);
+            _simd_axpy(n-k-1, -dot, &v[k+1], row, row);
+        }
+    }
+}
+
+/**
+ * @brief Y = Q * Y where Q is the product of the tridiagonalizing
+ *        reflectors
+ * 
+ */
+void SymmetricEigen::_apply_reflectors(Matrix& Y) const {
+    const size_t n = _diag.size();
+    const size_t ldy = Y.leading_dim(), columns = Y.num_columns();
+    if(n < 3)
+        return;
+    double* y = Y._mutable_data();
+    vector<double> w(columns);
+    for(size_t k=n-2; k-- > 0;) { // last reflector first
+        const double tau = _tau[k];
+        if(tau == 0)
+            continue;
+        fill(w.begin(), w.end(), 0.0);
+        for(size_t i=k+1; i<n; ++i) { // w = v^T * Y
+            const double vi = i == k+1 ? 1 : _a(i, k);
+            const double* row = y + i*ldy;
+            for(size_t j=0; j<columns; ++j)
+                w[j] += vi * row[j];
+        }
+        for(size_t i=k+1; i<n; ++i) { // Y -= tau * v * w^T
+            const double vi = tau * (i == k+1 ? 1 : _a(i, k));
+            double* row = y + i*ldy;
+            for(size_t j=0; j<columns; ++j)
+                row[j] -= vi * w[j];
+        }
+    }
+}
+
+/**
+ * @brief all eigenvalues of the tridiagonal form in ascending order
+ * 
+ */
+vector<double> SymmetricEigen::_tridiagonal_values() const {
+    vector<double> d(_diag), e(_sub);
+    if(!_tridiagonal_ql(d.size(), d.data(), e.data(), nullptr, 0))
+        throw runtime_error("Could not find values");
+    sort(d.begin(), d.end());
+    return d;
+}
+
+/**
+ * @brief keeps count eigenvalues from first in all (ascending), and finds
+ *        their eigenvectors by inverse iteration on the tridiagonal form;
+ *        vectors of close eigenvalues are kept orthogonal to each other
+ * 
+ */
+void SymmetricEigen::_select(const vector<double>& all, size_t first,
+                             size_t count, bool vectors) {
+    _values.assign(all.begin() + first, all.begin() + first + count);
+    if(!vectors || !count) {
+        _a = Matrix();
+        return;
+    }
+    const size_t n = _diag.size();
+    const double eps = numeric_limits<double>::epsilon();
+    double norm = 0;
+    for(size_t i=0; i<n; ++i)
+        norm = max(norm, fabs(_diag[i]) + fabs(_sub[i])
+                         + (i ? fabs(_sub[i-1]) : 0));
+    const double gap = 1e-3 * norm; // closer eigenvalues form a cluster
+    const double nudge = 10 * eps * max(norm, 1.0);
+
+    vector<double> X(count * n), work;
+    minstd_rand rng(1);
+    uniform_real_distribution<double> dist(-1, 1);
+    size_t clusterStart = 0;
+    double lambda = 0;
+    for(size_t j=0; j<count; ++j) {
+        double previous = lambda;
+        lambda = _values[j];
+        if(j && lambda - previous > gap)
+            clusterStart = j;
+        if(j && lambda <= previous + nudge) // keep equal shifts apart
+            lambda = previous + nudge;
+        double* x = X.data() + j*n;
+        for(size_t i=0; i<n; ++i)
+            x[i] = dist(rng);
+        for(int iter=0; iter<INVERSE_ITERATIONS; ++iter) {
+            _tridiagonal_shifted_solve(n, _diag.data(), _sub.data(), lambda,
+                                       eps * norm, x, work);
+            for(size_t c=clusterStart; c<j; ++c) { // Gram-Schmidt in cluster
+                const double* y = X.data() + c*n;
+                double dot = 0;
+                for(size_t i=0; i<n; ++i)
+                    dot += x[i] * y[i];
+                for(size_t i=0; i<n; ++i)
+                    x[i] -= dot * y[i];
+            }
+            double length = 0;
+            for(size_t i=0; i<n; ++i)
+                length += x[i] * x[i];
+            length = sqrt(length);
+            for(size_t i=0; i<n; ++i)
+                x[i] /= length;
+        }
+    }
+    _vectors = Matrix(n, count);
+    double* out = _vectors._mutable_data();
+    const size_t ldv = _vectors.leading_dim();
+    for(size_t j=0; j<count; ++j)
+        for(size_t i=0; i<n; ++i)
+            out[i*ldv + j] = X[j*n + i];
+    _apply_reflectors(_vectors);
+    _a = Matrix();
+}
+
+#pragma endregion // TRIDIAGONAL
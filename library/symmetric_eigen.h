@@ -0,0 +1,55 @@
+#pragma once
+#ifndef MATRIX_SYMMETRIC_EIGEN_H
+#define MATRIX_SYMMETRIC_EIGEN_H
+
+#include "matrix.h"
+#include <vector>
+
+/**
+ * @brief Eigenvalues and eigenvectors of a symmetric Matrix
+ * 
+ * The Matrix is reduced to tridiagonal form with Householder reflections
+ * (only its lower triangle is read or updated), then the tridiagonal
+ * eigenvalues are found by implicit QL. All eigenpairs come from rotating
+ * the accumulated reflectors during QL; a subset (by index or value range)
+ * skips that O(n^3) step and finds each selected eigenvector by inverse
+ * iteration on the tridiagonal form instead.
+ * 
+ * Eigenvalues are in ascending order; vectors() holds the matching unit
+ * eigenvectors as columns.
+ */
+class SymmetricEigen {
+public:
+
+    /* Constructors */
+
+    SymmetricEigen(const Matrix& A, bool vectors=true);
+    static SymmetricEigen by_index(const Matrix& A, std::size_t first,
+                                   std::size_t last, bool vectors=true);
+    static SymmetricEigen by_value(const Matrix& A, double low, double high,
+                                   bool vectors=true);
+
+    /* Get functions */
+
+    const std::vector<double>& values() const;
+    const Matrix& vectors() const;
+
+private:
+    Matrix _a; // reflectors below the subdiagonal, released once applied
+    std::vector<double> _tau; // scale of each reflector
+    std::vector<double> _diag; // diagonal of the tridiagonal form
+    std::vector<double> _sub; // subdiagonal of the tridiagonal form
+    std::vector<double> _values;
+    Matrix _vectors;
+
+    struct _Reduce {}; // tag for the constructor that only tridiagonalizes
+    SymmetricEigen(const Matrix& A, _Reduce);
+    void _tridiagonalize();
+    void _form_qt(Matrix& Zt) const;
+    void _apply_reflectors(Matrix& Y) const;
+    std::vector<double> _tridiagonal_values() const;
+    void _select(const std::vector<double>& all, std::size_t first,
+                 std::size_t count, bool vectors);
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdlib> // getenv(), strtoul()
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+/* true on pool worker threads and while a thread runs a parallel region, so
+   nested parallel_for calls run serially instead of deadlocking */
+static thread_local bool _inParallelRegion = false;
+
+/**
+ * @brief packs chunk range [lo, hi) into one word so it can be updated with
+ *        a single compare-and-swap
+ * 
+ */
+inline uint64_t _pack_range(uint64_t lo, uint64_t hi) {
+    return (lo << 32) | hi;
+}
+inline size_t _range_lo(uint64_t range) {
+    return range >> 32;
+}
+inline size_t _range_hi(uint64_t range) {
+    return range & 0xFFFFFFFFu;
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region CONSTRUCTORS
+
+/**
+ * @return pool shared by all Matrix operations
+ */
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+/**
+ * @brief Start one thread per hardware thread, or MATRIX_NUM_THREADS if set
+ * 
+ */
+ThreadPool::ThreadPool() {
+    size_t threads = thread::hardware_concurrency();
+    if(const char* env = getenv("MATRIX_NUM_THREADS"))
+        threads = strtoul(env, nullptr, 10);
+    _start(max<size_t>(threads, 1));
+}
+
+/**
+ * @brief Stop and join all worker threads
+ * 
+ */
+ThreadPool::~ThreadPool() {
+    _stop_workers();
+}
+
+#pragma endregion // CONSTRUCTORS
+/******************************************************************************/
+#pragma region SETTINGS
+
+/**
+ * @brief Set number of threads used by parallel operations (including the
+ *        calling thread)
+ * 
+ * @param threads total thread count, 0 resets to hardware thread count
+ */
+void ThreadPool::resize(size_t threads) {
+    if(!threads)
+        threads = max<size_t>(thread::hardware_concurrency(), 1);
+    lock_guard<mutex> lock(_resizeMutex);
+    if(threads == size())
+        return;
+    _stop_workers();
+    _start(threads);
+}
+
+/**
+ * @return number of threads used by parallel operations
+ */
+size_t ThreadPool::size() const {
+    return _workers.size() + 1;
+}
+
+#pragma endregion // SETTINGS
+/******************************************************************************/
+#pragma region PARALLEL_FOR
+
+/**
+ * @brief Calls func(lo, hi) over sub-ranges covering [begin, end)
+ * 
+ * The range is cut into chunks of grain indexes which are dealt out evenly to
+ * every thread; a thread that runs out steals the back half of the busiest
+ * remaining range. Runs serially on the calling thread when there is only
+ * one chunk, one thread, or when called from inside another parallel region.
+ * 
+ * @param grain minimum number of indexes handed to func at once
+ */
+void ThreadPool::parallel_for(size_t begin, size_t end, size_t grain,
+                              const RangeFunction& func) {
+    if(end <= begin)
+        return;
+    grain = max<size_t>(grain, 1);
+    size_t chunks = (end - begin + grain - 1) / grain;
+    if(chunks > 0xFFFFFFFFu) { // chunk indexes must fit in 32 bits
+        grain = (end - begin + 0xFFFFFFFEu) / 0xFFFFFFFFu;
+        chunks = (end - begin + grain - 1) / grain;
+    }
+    if(chunks == 1 || _inParallelRegion || !_resizeMutex.try_lock()) {
+        func(begin, end);
+        return;
+    }
+    lock_guard<mutex> resizeLock(_resizeMutex, adopt_lock);
+    if(_workers.empty()) {
+        func(begin, end);
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _func = &func;
+        _begin = begin;
+        _end = end;
+        _grain = grain;
+        for(size_t slot=0; slot<_slots; ++slot) { // deal chunks evenly
+            _ranges[slot].store(_pack_range(chunks * slot / _slots,
+                                            chunks * (slot+1) / _slots));
+        }
+        _failed = false;
+        _error = nullptr;
+        _active = _workers.size();
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    _inParallelRegion = true;
+    _run(0);
+    _inParallelRegion = false;
+
+    unique_lock<mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _active == 0; });
+    _func = nullptr;
+    if(_error)
+        rethrow_exception(_error);
+}
+
+#pragma endregion // PARALLEL_FOR
+/******************************************************************************/
+#pragma region WORKERS
+
+/**
+ * @brief spawns threads-1 workers (calling thread is the last participant)
+ * 
+ */
+void ThreadPool::_start(size_t threads) {
+    _stopping = false;
+    _slots = threads;
+    _ranges.reset(new atomic<uint64_t>[threads]);
+    for(size_t slot=0; slot<threads; ++slot)
+        _ranges[slot].store(0);
+    for(size_t slot=1; slot<threads; ++slot)
+        _workers.emplace_back(&ThreadPool::_worker_loop, this, slot,
+                              _generation);
+}
+
+/**
+ * @brief signals all workers to exit and joins them
+ * 
+ */
+void ThreadPool::_stop_workers() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for(thread& worker : _workers)
+        worker.join();
+    _workers.clear();
+}
+
+/**
+ * @brief waits for jobs and runs them until the pool stops
+ * 
+ * @param seen generation at spawn time (jobs up to it are not for us)
+ */
+void ThreadPool::_worker_loop(size_t slot, size_t seen) {
+    _inParallelRegion = true;
+    MATRIX_TRACE_THREAD("matrix worker " + to_string(slot));
+    unique_lock<mutex> lock(_mutex);
+    while(true) {
+        _wake.wait(lock, [&] { return _stopping || _generation != seen; });
+        if(_stopping)
+            return;
+        seen = _generation;
+        lock.unlock();
+        _run(slot);
+        lock.lock();
+        if(--_active == 0)
+            _done.notify_one();
+    }
+}
+
+/**
+ * @brief runs chunks from own range, then steals until no work is left
+ * 
+ */
+void ThreadPool::_run(size_t slot) {
+    size_t chunk;
+    do {
+        while(_pop(slot, chunk)) {
+            if(_failed)
+                continue; // drain remaining chunks without running them
+            size_t lo = _begin + chunk * _grain;
+            size_t hi = min(_end, lo + _grain);
+            try {
+                MATRIX_TRACE_SPAN("parallel chunk", hi - lo, 0, (long)lo);
+                (*_func)(lo, hi);
+            } catch(...) {
+                lock_guard<mutex> lock(_mutex);
+                if(!_error)
+                    _error = current_exception();
+                _failed = true;
+            }
+        }
+    } while(_steal(slot));
+}
+
+/**
+ * @brief takes the next chunk from the front of own range
+ * 
+ */
+bool ThreadPool::_pop(size_t slot, size_t& chunk) {
+    uint64_t range = _ranges[slot].load();
+    while(_range_lo(range) < _range_hi(range)) {
+        uint64_t next = _pack_range(_range_lo(range) + 1, _range_hi(range));
+        if(_ranges[slot].compare_exchange_weak(range, next)) {
+            chunk = _range_lo(range);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief moves the back half of the largest other range into own range
+ * 
+ * @return false if there was nothing left to steal
+ */
+bool ThreadPool::_steal(size_t slot) {
+    while(true) {
+        size_t victim = slot, most = 0;
+        for(size_t i=0; i<_slots; ++i) {
+            uint64_t range = _ranges[i].load();
+            size_t remaining = _range_hi(range) > _range_lo(range)
+                               ? _range_hi(range) - _range_lo(range) : 0;
+            if(i != slot && remaining > most) {
+                victim = i;
+                most = remaining;
+            }
+        }
+        if(!most)
+            return false;
+        uint64_t range = _ranges[victim].load();
+        size_t lo = _range_lo(range), hi = _range_hi(range);
+        if(lo >= hi)
+            continue; // emptied since scan, look again
+        size_t mid = hi - (hi - lo + 1) / 2;
+        if(_ranges[victim].compare_exchange_strong(range,
+                                                   _pack_range(lo, mid))) {
+            _ranges[slot].store(_pack_range(mid, hi));
+            return true;
+        }
+    }
+}
+
+#pragma endregion // WORKERS
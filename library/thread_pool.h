@@ -0,0 +1,87 @@
+#pragma once
+#ifndef MATRIX_THREAD_POOL_H
+#define MATRIX_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define PARALLEL_MIN_WORK 32768 // elements a task needs before threads pay off
+
+/**
+ * @brief Library owned pool of worker threads used by the Matrix kernels
+ * 
+ * The pool is created on first use with one thread per hardware thread (or
+ * MATRIX_NUM_THREADS from the environment) and can be resized at any time
+ * with ThreadPool::instance().resize(n). resize(1) makes every operation run
+ * on the calling thread.
+ */
+class ThreadPool {
+public:
+
+    typedef std::function<void(std::size_t, std::size_t)> RangeFunction;
+
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    void operator=(const ThreadPool&) = delete;
+
+    void resize(std::size_t threads);
+    std::size_t size() const;
+
+    void parallel_for(std::size_t begin, std::size_t end, std::size_t grain,
+                      const RangeFunction& func);
+
+private:
+    ThreadPool();
+
+    void _start(std::size_t threads);
+    void _stop_workers();
+    void _worker_loop(std::size_t slot, std::size_t seen);
+    void _run(std::size_t slot);
+    bool _pop(std::size_t slot, std::size_t& chunk);
+    bool _steal(std::size_t slot);
+
+    std::vector<std::thread> _workers;
+    std::mutex _resizeMutex; // held while a parallel region or resize runs
+    std::mutex _mutex; // guards job hand-off between caller and workers
+    std::condition_variable _wake; // signals workers of a new job
+    std::condition_variable _done; // signals caller all workers finished
+    std::size_t _generation = 0; // incremented for every job
+    std::size_t _active = 0; // workers still running the current job
+    bool _stopping = false;
+
+    /* Current job */
+    const RangeFunction* _func = nullptr;
+    std::size_t _begin = 0, _end = 0, _grain = 1;
+    std::size_t _slots = 0; // participants (workers + calling thread)
+    std::unique_ptr<std::atomic<std::uint64_t>[]> _ranges; // [lo,hi) chunks
+    std::atomic<bool> _failed{false};
+    std::exception_ptr _error;
+};
+
+/**
+ * @brief runs func(lo, hi) over row ranges covering [0, rows) of a matrix
+ *        with given row length, spreading rows over the thread pool only when
+ *        each task gets at least PARALLEL_MIN_WORK elements
+ * 
+ */
+template <typename F>
+void _for_rows(std::size_t rows, std::size_t columns, F func) {
+    std::size_t grain = std::max<std::size_t>(1, 
+        PARALLEL_MIN_WORK / std::max<std::size_t>(columns, 1));
+    if(rows <= grain)
+        func(std::size_t(0), rows);
+    else
+        ThreadPool::instance().parallel_for(0, rows, grain, func);
+}
+
+#endif
@@ -0,0 +1,179 @@
+#include "trace.h"
+#include <cstdio>
+#include <cstdlib> // getenv(), atexit()
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief one finished span
+ *
+ */
+struct _TraceEvent {
+    const char* name;
+    Tracing::clock::time_point start;
+    Tracing::clock::time_point end;
+    size_t rows;
+    size_t columns;
+    long index;
+    double flops;
+};
+
+/**
+ * @brief spans recorded by one thread (kept after the thread exits, until
+ *        the trace is written)
+ *
+ */
+struct _ThreadTrace {
+    mutex lock; // uncontended except while a trace is written
+    vector<_TraceEvent> events;
+    size_t tid;
+    string name;
+};
+
+static mutex _registryMutex; // guards everything below
+static vector<shared_ptr<_ThreadTrace>> _threads;
+static string _tracePath;
+static Tracing::clock::time_point _origin;
+static thread_local shared_ptr<_ThreadTrace> _thisThread;
+
+/**
+ * @return trace buffer of the calling thread, registered on first use
+ */
+_ThreadTrace& _thread_trace() {
+    if(!_thisThread) {
+        auto trace = make_shared<_ThreadTrace>();
+        lock_guard<mutex> lock(_registryMutex);
+        trace->tid = _threads.size() + 1;
+        trace->name = "thread " + to_string(trace->tid);
+        _threads.push_back(trace);
+        _thisThread = trace;
+    }
+    return *_thisThread;
+}
+
+/**
+ * @brief writes s as a JSON string
+ *
+ */
+void _write_json_string(FILE* file, const string& s) {
+    fputc('"', file);
+    for(char c : s) {
+        if(c == '"' || c == '\\')
+            fputc('\\', file);
+        if((unsigned char)c >= 0x20)
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region TRACING
+
+atomic<bool> Tracing::_active(false);
+
+/**
+ * @brief starts recording spans from all threads, to be written to path by
+ *        stop()
+ *
+ * @return false if a trace is already running
+ */
+bool Tracing::start(const string& path) {
+    lock_guard<mutex> lock(_registryMutex);
+    if(_active)
+        return false;
+    for(auto& thread : _threads) {
+        lock_guard<mutex> threadLock(thread->lock);
+        thread->events.clear();
+    }
+    _tracePath = path;
+    _origin = clock::now();
+    _active = true;
+    return true;
+}
+
+/**
+ * @brief stops recording and writes the trace (spans still open are left
+ *        out)
+ *
+ * @return false if no trace was running or the file could not be written
+ */
+bool Tracing::stop() {
+    lock_guard<mutex> lock(_registryMutex);
+    if(!_active.exchange(false))
+        return false;
+    FILE* file = fopen(_tracePath.c_str(), "w");
+    if(!file)
+        return false;
+    fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+          "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+          "\"args\": {\"name\": \"matrix\"}}", file);
+    for(auto& thread : _threads) {
+        lock_guard<mutex> threadLock(thread->lock);
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", "
+                "\"pid\": 1, \"tid\": %zu, \"args\": {\"name\": ", thread->tid);
+        _write_json_string(file, thread->name);
+        fputs("}}", file);
+        for(const _TraceEvent& event : thread->events) {
+            double ts = chrono::duration<double, micro>(
+                event.start - _origin).count();
+            double dur = chrono::duration<double, micro>(
+                event.end - event.start).count();
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                    "\"tid\": %zu, \"ts\": %.3f, \"dur\": %.3f, \"args\": "
+                    "{\"rows\": %zu, \"columns\": %zu", event.name,
+                    thread->tid, ts, dur, event.rows, event.columns);
+            if(event.index >= 0)
+                fprintf(file, ", \"index\": %ld", event.index);
+            if(event.flops > 0)
+                fprintf(file, ", \"flops\": %.17g", event.flops);
+            fputs("}}", file);
+        }
+        thread->events.clear();
+    }
+    fputs("\n]}\n", file);
+    return fclose(file) == 0;
+}
+
+/**
+ * @brief names the calling thread in traces (e.g. "matrix worker 3")
+ *
+ */
+void Tracing::name_thread(const string& name) {
+    _ThreadTrace& trace = _thread_trace();
+    lock_guard<mutex> lock(trace.lock);
+    trace.name = name;
+}
+
+/**
+ * @brief adds a finished span to the calling thread's buffer
+ *
+ */
+void Tracing::_complete(const char* name, clock::time_point start,
+                        clock::time_point end, size_t rows, size_t columns,
+                        long index, double flops) {
+    if(!active())
+        return;
+    _ThreadTrace& trace = _thread_trace();
+    lock_guard<mutex> lock(trace.lock);
+    trace.events.push_back({name, start, end, rows, columns, index, flops});
+}
+
+#ifdef MATRIX_INSTRUMENT
+/* MATRIX_TRACE=file traces from startup until exit */
+static const bool _traceFromEnvironment = [] {
+    const char* path = getenv("MATRIX_TRACE");
+    if(!path || !*path)
+        return false;
+    Tracing::start(path);
+    atexit([] { Tracing::stop(); });
+    return true;
+}();
+#endif
+
+#pragma endregion // TRACING
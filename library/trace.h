@@ -0,0 +1,91 @@
+#pragma once
+#ifndef MATRIX_TRACE_H
+#define MATRIX_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/*
+ * Opt-in tracing of Matrix operations and their internals (factorization
+ * panels, elimination columns, QR sweeps, thread pool chunks) as nested
+ * spans per thread, written in Chrome trace-event format for
+ * chrome://tracing, Perfetto or speedscope.
+ *
+ * Spans are compiled in with MATRIX_INSTRUMENT (see instrument.h) and only
+ * recorded between Tracing::start() and Tracing::stop(); setting
+ * MATRIX_TRACE=file in the environment traces the whole run into file. While
+ * no trace is running a span costs one relaxed atomic load.
+ */
+
+/**
+ * @brief Records spans from all threads and writes them as a Chrome trace
+ *
+ */
+class Tracing {
+public:
+
+    typedef std::chrono::steady_clock clock;
+
+    static bool start(const std::string& path);
+    static bool stop();
+    static bool active() {
+        return _active.load(std::memory_order_relaxed);
+    }
+    static void name_thread(const std::string& name);
+
+    static void _complete(const char* name, clock::time_point start,
+                          clock::time_point end, std::size_t rows,
+                          std::size_t columns, long index, double flops);
+
+private:
+    static std::atomic<bool> _active;
+};
+
+/**
+ * @brief records one span on the calling thread for as long as it lives
+ *        (see MATRIX_TRACE_SPAN)
+ *
+ */
+class _TraceSpan {
+public:
+    _TraceSpan(const char* name, std::size_t rows, std::size_t columns,
+               long index=-1)
+            : _name(Tracing::active() ? name : nullptr), _rows(rows),
+              _columns(columns), _index(index) {
+        if(_name)
+            _start = Tracing::clock::now();
+    }
+    ~_TraceSpan() {
+        if(_name)
+            Tracing::_complete(_name, _start, Tracing::clock::now(), _rows,
+                               _columns, _index, 0);
+    }
+    _TraceSpan(const _TraceSpan&) = delete;
+    void operator=(const _TraceSpan&) = delete;
+
+private:
+    const char* _name; // nullptr when no trace was running at construction
+    std::size_t _rows;
+    std::size_t _columns;
+    long _index; // step within the enclosing operation, -1 for none
+    Tracing::clock::time_point _start;
+};
+
+#define _MATRIX_CONCAT(a, b) a##b
+#define _MATRIX_SPAN_NAME(line) _MATRIX_CONCAT(_matrix_trace_span, line)
+
+#ifdef MATRIX_INSTRUMENT
+/* traces the rest of the enclosing block as a span on a rows x columns
+   problem, index numbering it within its parent (e.g. a column, -1 none) */
+#define MATRIX_TRACE_SPAN(name, rows, columns, index) \
+    _TraceSpan _MATRIX_SPAN_NAME(__LINE__)((name), (rows), (columns), (index))
+/* names the calling thread in traces */
+#define MATRIX_TRACE_THREAD(name) Tracing::name_thread(name)
+#else
+#define MATRIX_TRACE_SPAN(name, rows, columns, index) ((void)0)
+#define MATRIX_TRACE_THREAD(name) ((void)0)
+#endif
+
+#endif
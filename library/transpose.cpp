@@ -0,0 +1,96 @@
+#include "kernels.h"
+#include <algorithm>
+
+using namespace std;
+
+#define TRANSPOSE_BLOCK 32 // tile edge: a source and destination tile fit L1
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief B = A^T for one rows x columns tile (rows are contiguous in A)
+ * 
+ */
+template <typename T>
+inline void _transpose_tile(size_t rows, size_t columns,
+                            const T* A, size_t lda, T* B, size_t ldb) {
+    for(size_t i=0; i<rows; ++i) {
+        const T* a = A + i*lda;
+        for(size_t j=0; j<columns; ++j)
+            B[j*ldb + i] = a[j];
+    }
+}
+/**
+ * @brief swaps the rows x columns tile at A with the transpose of the
+ *        columns x rows tile at B (the tiles do not overlap)
+ * 
+ */
+template <typename T>
+inline void _swap_tiles(size_t rows, size_t columns,
+                        T* A, T* B, size_t ld) {
+    for(size_t i=0; i<rows; ++i) {
+        T* a = A + i*ld;
+        for(size_t j=0; j<columns; ++j)
+            swap(a[j], B[j*ld + i]);
+    }
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region TRANSPOSE
+
+/**
+ * @brief tiled out of place transpose: each TRANSPOSE_BLOCK square tile is
+ *        read and written while both sit in cache, and bands of destination
+ *        rows are spread over the thread pool
+ * 
+ */
+template <typename T>
+void _transpose(size_t rows, size_t columns, const T* A, size_t lda,
+                T* B, size_t ldb) {
+    size_t bands = (columns + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    _for_rows(bands, rows * TRANSPOSE_BLOCK, [&](size_t lo, size_t hi) {
+        for(size_t b=lo; b<hi; ++b) {
+            size_t j0 = b * TRANSPOSE_BLOCK;
+            size_t nj = min<size_t>(TRANSPOSE_BLOCK, columns - j0);
+            for(size_t i0=0; i0<rows; i0+=TRANSPOSE_BLOCK) {
+                size_t ni = min<size_t>(TRANSPOSE_BLOCK, rows - i0);
+                _transpose_tile(ni, nj, A + i0*lda + j0, lda,
+                                B + j0*ldb + i0, ldb);
+            }
+        }
+    });
+}
+
+/**
+ * @brief in place transpose of n x n A: tiles above the diagonal are swapped
+ *        with their mirror below it, diagonal tiles are transposed in place
+ * 
+ */
+template <typename T>
+void _transpose_square(size_t n, T* A, size_t lda) {
+    size_t bands = (n + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    _for_rows(bands, n * TRANSPOSE_BLOCK / 2, [&](size_t lo, size_t hi) {
+        for(size_t b=lo; b<hi; ++b) {
+            size_t i0 = b * TRANSPOSE_BLOCK;
+            size_t ni = min<size_t>(TRANSPOSE_BLOCK, n - i0);
+            T* diag = A + i0*lda + i0;
+            for(size_t i=0; i<ni; ++i)
+                for(size_t j=i+1; j<ni; ++j)
+                    swap(diag[i*lda + j], diag[j*lda + i]);
+            for(size_t j0=i0+ni; j0<n; j0+=TRANSPOSE_BLOCK) {
+                size_t nj = min<size_t>(TRANSPOSE_BLOCK, n - j0);
+                _swap_tiles(ni, nj, A + i0*lda + j0, A + j0*lda + i0, lda);
+            }
+        }
+    });
+}
+
+template void _transpose(size_t rows, size_t columns, const double* A,
+                         size_t lda, double* B, size_t ldb);
+template void _transpose(size_t rows, size_t columns, const float* A,
+                         size_t lda, float* B, size_t ldb);
+template void _transpose_square(size_t n, double* A, size_t lda);
+template void _transpose_square(size_t n, float* A, size_t lda);
+
+#pragma endregion // TRANSPOSE
@@ -0,0 +1,89 @@
+#include "kernels.h"
+#include <algorithm>
+
+using namespace std;
+
+#define TRSM_BLOCK 64 // rows substituted before the rest is updated by _gemm
+
+#pragma region PRIVATE_FUNCTONS
+
+/**
+ * @brief forward or back substitution on an nb x nb diagonal block, spread
+ *        over the columns of B
+ * 
+ */
+template <typename S>
+void _trsm_block(bool lower, bool unit, size_t nb, size_t k,
+                 const S* T, size_t rst, size_t cst,
+                 S* B, size_t ldb) {
+    size_t grain = max<size_t>(16, PARALLEL_MIN_WORK / (nb * nb));
+    auto substitute = [&](size_t lo, size_t hi) {
+        for(size_t step=0; step<nb; ++step) {
+            size_t r = lower ? step : nb - 1 - step;
+            S* br = B + r*ldb;
+            size_t p0 = lower ? 0 : r + 1, p1 = lower ? r : nb;
+            for(size_t p=p0; p<p1; ++p) {
+                const S t = T[r*rst + p*cst];
+                const S* bp = B + p*ldb;
+                for(size_t j=lo; j<hi; ++j)
+                    br[j] -= t * bp[j];
+            }
+            if(!unit) {
+                const S d = T[r*rst + r*cst];
+                for(size_t j=lo; j<hi; ++j)
+                    br[j] /= d;
+            }
+        }
+    };
+    if(k <= grain)
+        substitute(0, k);
+    else
+        ThreadPool::instance().parallel_for(0, k, grain, substitute);
+}
+
+#pragma endregion // PRIVATE_FUNCTONS
+/******************************************************************************/
+#pragma region TRSM
+
+/**
+ * @brief blocked triangular solve: substitute TRSM_BLOCK rows at a time, then
+ *        remove their contribution from the remaining rows with one _gemm
+ *        call, so most of the work runs in the packed multiply kernel
+ * 
+ */
+template <typename S>
+void _trsm(bool lower, bool unit, size_t n, size_t k,
+           const S* T, size_t rst, size_t cst,
+           S* B, size_t ldb) {
+    if(!n || !k)
+        return;
+    if(lower) {
+        for(size_t i0=0; i0<n; i0+=TRSM_BLOCK) {
+            size_t nb = min<size_t>(TRSM_BLOCK, n - i0), i1 = i0 + nb;
+            _trsm_block(true, unit, nb, k, T + i0*rst + i0*cst, rst, cst,
+                        B + i0*ldb, ldb);
+            if(i1 < n)
+                _gemm<S>(n - i1, k, nb, -1, T + i1*rst + i0*cst, rst, cst,
+                         B + i0*ldb, ldb, 1, 1, B + i1*ldb, ldb);
+        }
+    } else {
+        for(size_t i1=n; i1>0;) {
+            size_t i0 = i1 > TRSM_BLOCK ? i1 - TRSM_BLOCK : 0, nb = i1 - i0;
+            _trsm_block(false, unit, nb, k, T + i0*rst + i0*cst, rst, cst,
+                        B + i0*ldb, ldb);
+            if(i0 > 0)
+                _gemm<S>(i0, k, nb, -1, T + i0*cst, rst, cst,
+                         B + i0*ldb, ldb, 1, 1, B, ldb);
+            i1 = i0;
+        }
+    }
+}
+
+template void _trsm(bool lower, bool unit, size_t n, size_t k,
+                    const double* T, size_t rst, size_t cst,
+                    double* B, size_t ldb);
+template void _trsm(bool lower, bool unit, size_t n, size_t k,
+                    const float* T, size_t rst, size_t cst,
+                    float* B, size_t ldb);
+
+#pragma endregion // TRSM
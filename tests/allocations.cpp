@@ -0,0 +1,197 @@
+/*
+ * Allocation tests: compound updates, moves and decomposition loops must not
+ * copy Matrix storage
+ *
+ * Build and run (from repository root):
+ *   cmake -S . -B build && cmake --build build && ctest --test-dir build
+ *
+ * Every operator new is counted. Each operation runs once to warm up (thread
+ * pool, instrumentation tables) before the counted run, and sizes stay below
+ * PARALLEL_MIN_WORK so the operations run on the calling thread.
+ */
+#include "test_helpers.h"
+#include "cholesky.h"
+#include "lu.h"
+#include "qr.h"
+#include "symmetric_eigen.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+#pragma region ALLOCATION_COUNTING
+
+static atomic<size_t> g_allocs(0); // operator new calls
+static atomic<size_t> g_bytes(0); // bytes requested from operator new
+
+void* _counted_new(size_t size) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_bytes.fetch_add(size, memory_order_relaxed);
+    if(void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+void* _counted_new(size_t size, align_val_t align) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_bytes.fetch_add(size, memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    size = (size + alignment - 1) / alignment * alignment;
+    if(void* ptr = aligned_alloc(alignment, size ? size : alignment))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new(size_t size) { return _counted_new(size); }
+void* operator new[](size_t size) { return _counted_new(size); }
+void* operator new(size_t size, align_val_t align) {
+    return _counted_new(size, align);
+}
+void* operator new[](size_t size, align_val_t align) {
+    return _counted_new(size, align);
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_bytes.fetch_add(size, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, const nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const nothrow_t&) noexcept { free(ptr); }
+
+/**
+ * @brief operator new calls and bytes made by one call of func
+ *
+ */
+struct Allocations {
+    size_t calls;
+    size_t bytes;
+};
+Allocations count_allocations(const function<void()>& func) {
+    size_t calls = g_allocs.load(), bytes = g_bytes.load();
+    func();
+    return {g_allocs.load() - calls, g_bytes.load() - bytes};
+}
+/**
+ * @brief allocations of the second of two calls of func
+ *
+ */
+Allocations warm_allocations(const function<void()>& func) {
+    func();
+    return count_allocations(func);
+}
+
+#pragma endregion // ALLOCATION_COUNTING
+/******************************************************************************/
+#pragma region HELPERS
+
+/**
+ * @brief check() that made no allocations, printing them if it did
+ *
+ */
+void check_none(const Allocations& made, const char* name) {
+    if(made.calls)
+        printf("    %zu allocations, %zu bytes\n", made.calls, made.bytes);
+    check(made.calls == 0, name);
+}
+
+#pragma endregion // HELPERS
+/******************************************************************************/
+#pragma region TESTS
+
+/**
+ * @brief compound operators return references and update in place
+ *
+ */
+void test_compound_updates(size_t n) {
+    Matrix A = test_matrix(n), B = test_matrix(n, true), C(n, n, 1.0);
+    check_none(warm_allocations([&] { (C += A * 2.0 - B) -= A / 4.0; }),
+               "chained += and -= of expressions");
+    check_none(warm_allocations([&] { ((C += A) -= B) *= 0.5; }),
+               "chained +=, -= and *= of matrices");
+    check_none(warm_allocations([&] { C /= 2.0; }), "/= scale");
+    check_none(warm_allocations([&] { C = A + B - C * 0.5; }),
+               "expression assigned to a Matrix it reads");
+    Matrix D(n, n);
+    check_none(warm_allocations([&] { D = C; }),
+               "copy assignment into a large enough Matrix");
+}
+
+/**
+ * @brief moves hand over storage
+ *
+ */
+void test_moves(size_t n) {
+    Matrix A = test_matrix(n);
+    check_none(count_allocations([&] {
+        Matrix B(std::move(A));
+        A = std::move(B);
+    }), "move construction and move assignment");
+    Matrix B = test_matrix(n);
+    check_none(count_allocations([&] { swap(A, B); }), "swap");
+}
+
+/**
+ * @brief factorizations of an rvalue take its storage, and solving against
+ *        a factorization in a loop allocates nothing
+ *
+ */
+void test_decompositions(size_t n) {
+    const size_t matrixBytes = n * n * sizeof(double);
+    Allocations made = count_allocations([&] { LU lu(test_matrix(n)); });
+    check(made.bytes < 2 * matrixBytes, "LU of an rvalue copies nothing");
+    made = count_allocations([&] { Cholesky ch(test_matrix(n, true)); });
+    check(made.bytes < 2 * matrixBytes, "Cholesky of an rvalue copies nothing");
+
+    LU lu(test_matrix(n));
+    Cholesky ch(test_matrix(n, true));
+    vector<double> x(n, 1.0);
+    Matrix X(n, 4, 1.0);
+    check_none(warm_allocations([&] {
+        for(int k=0; k<10; ++k) {
+            lu.solve_in_place(x);
+            lu.solve_in_place(X.view());
+        }
+    }), "LU solve_in_place loop");
+    check_none(warm_allocations([&] {
+        for(int k=0; k<10; ++k) {
+            ch.solve_in_place(x);
+            ch.solve_in_place(X.view());
+        }
+    }), "Cholesky solve_in_place loop");
+
+    /* iterative loops: work grows with n, allocations must not */
+    const Matrix small = test_matrix(n / 4), large = test_matrix(n);
+    const Matrix smallSym = test_matrix(n / 4, true);
+    const Matrix largeSym = test_matrix(n, true);
+    size_t smallCalls = warm_allocations([&] { small.eigenvalues(); }).calls;
+    size_t largeCalls = warm_allocations([&] { large.eigenvalues(); }).calls;
+    check(smallCalls == largeCalls, "eigenvalues() QR sweeps allocate nothing");
+    smallCalls = warm_allocations([&] { SymmetricEigen e(smallSym); }).calls;
+    largeCalls = warm_allocations([&] { SymmetricEigen e(largeSym); }).calls;
+    check(smallCalls == largeCalls, "SymmetricEigen QL sweeps allocate nothing");
+}
+
+#pragma endregion // TESTS
+
+int main() {
+    const size_t n = 48; // n * n < PARALLEL_MIN_WORK
+    test_compound_updates(n);
+    test_moves(n);
+    test_decompositions(n);
+    return test_result();
+}
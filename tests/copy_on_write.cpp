@@ -0,0 +1,154 @@
+/*
+ * Copy-on-write tests: copies share storage only while nothing can write it,
+ * and any number of threads may read a Matrix, through const or non-const
+ * accessors, while it is being copied
+ *
+ * Build and run (from repository root):
+ *   cmake -S . -B build && cmake --build build && ctest --test-dir build
+ *
+ * Build with -fsanitize=thread to check the readers for data races.
+ */
+#include "test_helpers.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#pragma region HELPERS
+
+/**
+ * @brief runs func(t) on count threads at once and waits for all of them
+ *
+ */
+template <typename F>
+void run_threads(int count, F func) {
+    vector<thread> threads;
+    for(int t=0; t<count; ++t)
+        threads.emplace_back(func, t);
+    for(thread& th : threads)
+        th.join();
+}
+
+/**
+ * @return true if a copy of M shares its storage (compared through const
+ *         pointers, which leave both Matrices shareable)
+ */
+bool copy_shares(const Matrix& M) {
+    const Matrix copy = M;
+    return copy.data() == M.data();
+}
+
+#pragma endregion // HELPERS
+/******************************************************************************/
+#pragma region TESTS
+
+/**
+ * @brief writes to a copy, a view or a pointer change only their own Matrix
+ *
+ */
+void test_semantics(size_t n) {
+    const Matrix A = numbered(n);
+    Matrix B = A;
+    B(0, 0) = -1;
+    check(A(0, 0) == 0 && B(0, 0) == -1, "writing a copy leaves the original");
+
+    Matrix C = numbered(n);
+    auto view = C.view();
+    double* data = C.data();
+    Matrix D = C;
+    view(1, 1) = -1;
+    data[2] = -2;
+    check(C(1, 1) == -1 && C(0, 2) == -2, "view and pointer write their Matrix");
+    check(D(1, 1) == n + 1 && D(0, 2) == 2,
+          "view and pointer taken before a copy miss the copy");
+
+    Matrix E(n, n);
+    auto eView = E.view();
+    E = A;
+    eView(0, 1) = -3;
+    check(E(0, 1) == -3 && A(0, 1) == 1,
+          "view of an assigned Matrix stays on its storage");
+
+    Matrix F = numbered(n);
+    Matrix G = std::move(F);
+    Matrix H = G;
+    G(0, 0) = -4;
+    check(H(0, 0) == 0, "moves keep a Matrix unshareable");
+}
+
+/**
+ * @brief results computed by the library are shareable: copying them costs
+ *        no element copy
+ *
+ */
+void test_shared_results(size_t n) {
+    const Matrix A = test_matrix(n), S = test_matrix(n, true);
+    const Matrix B = numbered(n);
+    const vector<double> x(n, 1.0);
+    check(copy_shares(A * B) && copy_shares(A * x) && copy_shares(x * A)
+          && copy_shares(A.transpose()) && copy_shares(A + B),
+          "copies of products and sums share storage");
+    check(copy_shares(A.inverse()) && copy_shares(S.inverse())
+          && copy_shares(A.solve(B)) && copy_shares(S.solve(B)),
+          "copies of inverse() and solve() share storage");
+    const LU lu = A.lu();
+    const Cholesky cholesky = S.cholesky();
+    check(copy_shares(lu.L()) && copy_shares(lu.U())
+          && copy_shares(lu.factors()) && copy_shares(cholesky.L()),
+          "copies of LU and Cholesky factors share storage");
+    check(copy_shares(A.qr(Matrix::Q)) && copy_shares(A.qr(Matrix::R)),
+          "copies of QR factors share storage");
+    check(copy_shares(SymmetricEigen(S).vectors()),
+          "copies of SymmetricEigen vectors share storage");
+    const SparseMatrix sparse(A);
+    check(copy_shares(sparse.to_dense()) && copy_shares(sparse * B),
+          "copies of SparseMatrix results share storage");
+}
+
+/**
+ * @brief threads read through const and non-const accessors while another
+ *        thread copies the Matrix
+ *
+ */
+void test_concurrent_readers(size_t n, int threads) {
+    Matrix A = numbered(n);
+    Matrix keep = A; // copies the elements: A handed out references
+    atomic<int> wrong(0);
+    run_threads(threads, [&](int t) {
+        for(int pass=0; pass<20; ++pass) {
+            double sum = 0;
+            for(size_t i=0; i<n; ++i)
+                sum += A(i, i) + A.at(i, i) + A.data()[i*A.leading_dim() + i];
+            wrong += sum != 3.0 * (n + 1) * n * (n - 1) / 2;
+            if(t == 0) {
+                Matrix copy = A;
+                wrong += copy(n - 1, n - 1) != n * n - 1.0;
+            }
+        }
+    });
+    check(!wrong, "non-const readers of one Matrix on many threads");
+
+    /* never written through mutable accessors: copies share the storage */
+    const Matrix shared = Matrix(n, n, 1.0) * 2.0;
+    run_threads(threads, [&](int) {
+        for(int pass=0; pass<50; ++pass) {
+            Matrix copy = shared;
+            double sum = 0;
+            for(size_t i=0; i<n; ++i)
+                sum += copy.data()[i*copy.leading_dim() + i] + shared(i, i);
+            wrong += sum != 4.0 * n;
+        }
+    });
+    check(!wrong, "copying one Matrix on many threads");
+    check(keep(n - 1, n - 1) == n * n - 1.0, "copy taken before the readers");
+}
+
+#pragma endregion // TESTS
+
+int main() {
+    test_semantics(8);
+    test_shared_results(8);
+    test_concurrent_readers(64, 4);
+    return test_result();
+}
@@ -0,0 +1,175 @@
+/*
+ * Decomposition tests: LU, QR and eigenvalue results checked against the
+ * Matrix they came from
+ *
+ * Build and run (from repository root):
+ *   cmake -S . -B build && cmake --build build && ctest --test-dir build
+ */
+#include "test_helpers.h"
+#include "lu.h"
+#include "qr.h"
+#include "symmetric_eigen.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+#pragma region HELPERS
+
+/**
+ * @return largest absolute difference between elements of A and B
+ */
+double max_error(const Matrix& A, const Matrix& B) {
+    double error = 0;
+    for(int i=0; i<A.num_rows(); ++i)
+        for(int j=0; j<A.num_columns(); ++j)
+            error = max(error, fabs(A(i, j) - B(i, j)));
+    return error;
+}
+
+#pragma endregion // HELPERS
+/******************************************************************************/
+#pragma region TESTS
+
+/**
+ * @brief P * A = L * U, solve() and determinant() agree with it
+ *
+ */
+void test_lu(size_t n) {
+    const Matrix A = random_matrix(n, n);
+    LU lu(A);
+    check(!lu.singular(), "LU of a random Matrix is not singular");
+    const Matrix LU_ = lu.L() * lu.U();
+    const vector<size_t>& perm = lu.permutation();
+    Matrix PA(n, n);
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<n; ++j)
+            PA(i, j) = A(perm[i], j);
+    check(max_error(PA, LU_) < 1e-12 * n, "LU reproduces P * A");
+
+    const Matrix B = random_matrix(n, 3, 2);
+    check(max_error(A * lu.solve(B), B) < 1e-10, "LU solve() solves A * X = B");
+    check(max_error(A * lu.inverse(), Matrix(n)) < 1e-10,
+          "LU inverse() is the inverse");
+
+    const Matrix T = {{2, 1, 0}, {1, 3, 1}, {0, 1, 4}};
+    check(fabs(LU(T).determinant() - 18) < 1e-12, "LU determinant()");
+    check(LU(Matrix{{1, 2}, {2, 4}}).singular(), "LU finds a singular Matrix");
+
+    /* rank 2: elimination leaves a pivot of rounding error, not zero */
+    const Matrix rank2 = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    LU deficient(rank2);
+    check(deficient.singular() && rank2.determinant() == 0,
+          "LU finds a rank deficient Matrix");
+    bool threw = false;
+    try {
+        deficient.inverse();
+    } catch(const domain_error&) {
+        threw = true;
+    }
+    check(threw && rank2.inverse().empty(),
+          "inverse() of a rank deficient Matrix fails");
+    threw = false;
+    try {
+        rank2.solve(vector<double>{1, 2, 3});
+    } catch(const domain_error&) {
+        threw = true;
+    }
+    check(threw, "solve() against a rank deficient Matrix throws");
+}
+
+/**
+ * @brief Q * R = A with orthonormal Q and upper triangular R
+ *
+ */
+void test_qr(size_t rows, size_t columns) {
+    const Matrix A = random_matrix(rows, columns, 3);
+    HouseholderQR qr(A);
+    const Matrix Q = qr.Q(), R = qr.R();
+    check(max_error(Q * R, A) < 1e-12 * rows, "QR reproduces A");
+    check(max_error(Q.transpose() * Q, Matrix(columns)) < 1e-12 * rows,
+          "QR Q has orthonormal columns");
+    bool upper = true;
+    for(int i=0; i<R.num_rows(); ++i)
+        for(int j=0; j<i; ++j)
+            upper = upper && R(i, j) == 0;
+    check(upper, "QR R is upper triangular");
+
+    const Matrix B = random_matrix(rows, 2, 4);
+    const Matrix X = qr.solve(B);
+    const Matrix residual = A.transpose() * (A * X - B);
+    check(max_error(residual, Matrix(columns, 2, 0.0)) < 1e-10,
+          "QR solve() is the least squares solution");
+}
+
+/**
+ * @brief eigenvalues of matrices with known spectra, and A * v = lambda * v
+ *        for every symmetric eigenpair
+ *
+ */
+void test_eigen(size_t n) {
+    /* upper triangular: eigenvalues are the diagonal */
+    Matrix T = random_matrix(n, n, 5);
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<i; ++j)
+            T(i, j) = 0;
+    for(size_t i=0; i<n; ++i)
+        T(i, i) = i + 1.0;
+    vector<double> values = T.eigenvalues_approx();
+    bool found = values.size() == n;
+    for(size_t i=0; i<values.size(); ++i)
+        found = found && fabs(values[i] - (n - i)) < 1e-8;
+    check(found, "eigenvalues_approx() of a triangular Matrix");
+
+    /* rotation: eigenvalues are cos(t) +- i sin(t) */
+    const double t = 0.5;
+    const Matrix rotation = {{cos(t), -sin(t)}, {sin(t), cos(t)}};
+    vector<complex<double>> complexValues = rotation.eigenvalues();
+    check(complexValues.size() == 2
+          && abs(complexValues[0] - polar(1.0, t)) < 1e-12
+          && abs(complexValues[1] - polar(1.0, -t)) < 1e-12,
+          "eigenvalues() of a rotation are a conjugate pair");
+
+    /* zero: every subdiagonal is already negligible */
+    const Matrix zero(n, n, 0.0);
+    values = zero.eigenvalues_approx();
+    complexValues = zero.eigenvalues();
+    bool zeros = values.size() == n && complexValues.size() == n;
+    for(size_t i=0; zeros && i<n; ++i)
+        zeros = values[i] == 0 && complexValues[i] == 0.0;
+    check(zeros, "eigenvalues() of a zero Matrix are zero");
+
+    const Matrix R = random_matrix(n, n, 6);
+    const Matrix S = R + R.transpose();
+    SymmetricEigen eigen(S);
+    const vector<double>& lambda = eigen.values();
+    const Matrix& V = eigen.vectors();
+    check(is_sorted(lambda.begin(), lambda.end()),
+          "SymmetricEigen values are ascending");
+    Matrix VL = V;
+    for(size_t i=0; i<n; ++i)
+        for(size_t j=0; j<n; ++j)
+            VL(i, j) *= lambda[j];
+    check(max_error(S * V, VL) < 1e-10 * n, "SymmetricEigen A * V = V * L");
+    check(max_error(V.transpose() * V, Matrix(n)) < 1e-10 * n,
+          "SymmetricEigen vectors are orthonormal");
+
+    SymmetricEigen some = SymmetricEigen::by_index(S, 2, 4);
+    bool matches = some.values().size() == 3;
+    for(size_t k=0; matches && k<3; ++k)
+        matches = fabs(some.values()[k] - lambda[k + 2]) < 1e-10 * n;
+    check(matches, "SymmetricEigen by_index() matches the full solve");
+}
+
+#pragma endregion // TESTS
+
+int main() {
+    test_lu(100);
+    test_qr(100, 100);
+    test_qr(150, 60);
+    test_eigen(60);
+    return test_result();
+}
@@ -0,0 +1,78 @@
+#pragma once
+#ifndef MATRIX_TEST_HELPERS_H
+#define MATRIX_TEST_HELPERS_H
+
+#include "matrix.h"
+#include <cstdio>
+#include <random>
+
+/*
+ * Checks and test matrices shared by the tests; each test is its own
+ * executable, so each gets its own failure count.
+ */
+
+inline int g_failures = 0;
+
+/**
+ * @brief reports a failed check (tests keep running to report every failure)
+ *
+ */
+inline void check(bool passed, const char* name) {
+    std::printf("%-52s %s\n", name, passed ? "ok" : "FAILED");
+    g_failures += !passed;
+}
+
+/**
+ * @brief prints the number of failed checks, if any
+ *
+ * @return exit status for main()
+ */
+inline int test_result() {
+    if(g_failures)
+        std::printf("\n%d checks failed\n", g_failures);
+    return g_failures ? 1 : 0;
+}
+
+/**
+ * @brief Matrix of given size filled with uniform values in [-1, 1)
+ *
+ */
+inline Matrix random_matrix(std::size_t rows, std::size_t columns,
+                            unsigned seed=1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    Matrix M(rows, columns);
+    for(std::size_t i=0; i<rows; ++i)
+        for(std::size_t j=0; j<columns; ++j)
+            M(i, j) = dist(rng);
+    return M;
+}
+
+/**
+ * @brief n x n Matrix with small off diagonal elements and n on the
+ *        diagonal, well conditioned and (when symmetric) positive definite
+ *
+ */
+inline Matrix test_matrix(std::size_t n, bool symmetric=false) {
+    Matrix M(n, n);
+    for(std::size_t i=0; i<n; ++i)
+        for(std::size_t j=0; j<n; ++j)
+            M(i, j) = i == j ? n : symmetric ? 1.0 / (1 + i + j)
+                                             : ((i*7 + j*3) % 11) / 11.0 - 0.5;
+    return M;
+}
+
+/**
+ * @brief n x n Matrix with element (i, j) = i * n + j, filled through
+ *        non-const operator()
+ *
+ */
+inline Matrix numbered(std::size_t n) {
+    Matrix M(n, n);
+    for(std::size_t i=0; i<n; ++i)
+        for(std::size_t j=0; j<n; ++j)
+            M(i, j) = i * n + j;
+    return M;
+}
+
+#endif